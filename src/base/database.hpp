@@ -6,43 +6,195 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <userver/concurrent/background_task_storage.hpp>
 #include <userver/engine/async.hpp>
+#include <userver/engine/condition_variable.hpp>
+#include <userver/engine/mutex.hpp>
+#include <userver/engine/task/cancel.hpp>
+#include <userver/engine/task/current_task.hpp>
+#include <userver/engine/task/task_processor_fwd.hpp>
+#include <userver/rcu/rcu.hpp>
+#include <utility>
 #include <vector>
-#include "../skiplist/skiplist.hpp"
+#include "../bloom/prefix_extractor.hpp"
+#include "../cache/block_cache.hpp"
+#include "../compaction/compaction_policy.hpp"
+#include "../configs/db_config.hpp"
+#include "../iterator/kv_iterator.hpp"
+#include "../manifest/manifest.hpp"
 #include "../sstable/sstable.hpp"
 #include "../wal/wal.hpp"
 #include "db_entry.hpp"
+#include "memtable.hpp"
 
 namespace DB {
 
 class Database {
 private:
-    SkipListMap<std::string, DBEntry> memtable;
-    std::vector<std::shared_ptr<SSTable>> sstables;
-    std::unique_ptr<SkipListMap<std::string, DBEntry>> flushBuffer;
-    size_t memtableLimit;
-    size_t sstableLimit;
+    // Everything a reader needs, published through RCU so lookups never take
+    // db_mutex. Writers mutate `memtable` in place (serialized by db_mutex)
+    // and replace the whole state when the set of tables changes.
+    struct ReadState {
+        std::shared_ptr<MemTable> memtable;
+        // Sealed memtables waiting to be flushed, oldest first.
+        std::vector<std::shared_ptr<MemTable>> immutables;
+        // DBConfig::kNumLevels entries; see LevelTables.
+        LevelTables levels;
+    };
+
+    userver::rcu::Variable<ReadState> state_;
+    size_t memtableBytes;
     std::string directory;
+    // Shared by every table this database opens.
+    std::shared_ptr<BlockCache> blockCache_;
+    // Paces flush and compaction I/O; fed with GET and scan latencies.
+    RateLimiter backgroundIo_;
     WAL wal_;
+    Manifest manifest_;
     mutable userver::engine::Mutex db_mutex;
-    std::atomic<bool> mergeInProgress{false};
+    // Only one compaction runs at a time; set while the worker is active.
+    std::atomic<bool> compactionInProgress_{false};
+    // Used by the compaction worker under db_mutex.
+    std::unique_ptr<CompactionPolicy> compactionPolicy_;
+    // Prefixes written to the filters of new tables and used to skip
+    // tables during prefix scans.
+    PrefixExtractor prefixExtractor_;
+
+    userver::engine::TaskProcessor &flushTaskProcessor_;
+    // Blocking file I/O at startup.
+    userver::engine::TaskProcessor &fsTaskProcessor_;
+    userver::engine::TaskProcessor &compactionTaskProcessor_;
+    // Guarded by db_mutex.
+    bool flushScheduled_ = false;
+    // WAL sequence numbers of the last write appended to the log and the
+    // last one applied to the memtable (or dropped because its commit
+    // failed). Writes are applied in log order once durable. Guarded by
+    // db_mutex.
+    uint64_t appendedSeq_ = 0;
+    uint64_t appliedSeq_ = 0;
+    // Set while sealMemtable() waits for appended writes to be applied;
+    // new appends wait meanwhile. Guarded by db_mutex.
+    bool sealing_ = false;
+    // Signalled when appliedSeq_ advances or a seal finishes.
+    userver::engine::ConditionVariable writesApplied_;
+    // Last WAL segment covering each sealed memtable, parallel to
+    // ReadState::immutables. Guarded by db_mutex.
+    std::vector<uint64_t> immutableSegments_;
+    // Bumped under db_mutex on every change to the table set.
+    uint64_t manifestVersion_ = 0;
+    // Serializes manifest writes, which happen outside db_mutex.
+    userver::engine::Mutex manifestMutex_;
+    // Last version written. Guarded by manifestMutex_.
+    uint64_t manifestWritten_ = 0;
+    // Signalled whenever immutable memtables or SSTables are published.
+    userver::engine::ConditionVariable tablesChanged_;
+    userver::engine::TaskWithResult<void> flushTask_;
+    userver::concurrent::BackgroundTaskStorageCore compactionTasks_;
+
+    // These require db_mutex to be held.
+    // Also waits out a seal in progress, so a write may be appended next.
+    void delayWrite(std::unique_lock<userver::engine::Mutex> &lock);
+    // Waits until every appended write is in the memtable, then moves it to
+    // the immutables together with the WAL segments holding its records.
+    void sealMemtable(std::unique_lock<userver::engine::Mutex> &lock);
+    void scheduleCompaction();
+    void scheduleFlush();
+    // Snapshot of the table set for the manifest, with a new version.
+    std::pair<uint64_t, std::vector<TableMeta>> manifestSnapshot(
+        const ReadState &state
+    );
+
+    // Waits for the WAL record `seq` to be durable, then applies `entry` to
+    // the memtable once every earlier record has been applied. If the commit
+    // fails the entry is dropped and the error rethrown, so a write reported
+    // as failed is never visible. Called without db_mutex.
+    void applyCommitted(uint64_t seq, std::string &&key, DBEntry &&entry);
 
-    void flushMemtable();
-    void mergeWorker();
+    void flushWorker();
+    void compactionWorker();
+    // Merges the job's inputs into new tables, split into parallel
+    // subcompactions when large enough; returns false or throws on failure.
+    bool runCompaction(const CompactionJob &job);
+    // Writes the job's output for keys in [start, end) and returns the new
+    // files; an empty bound is open. Removes its files if it throws.
+    std::vector<std::string> compactRange(
+        const CompactionJob &job,
+        std::string_view start,
+        std::string_view end
+    );
+    // Writes `tables` unless a newer version is already on disk. Must not
+    // be called with db_mutex held.
+    bool persistManifest(uint64_t version, const std::vector<TableMeta> &tables);
     void loadSSTables();
-    std::optional<std::vector<uint8_t>> selectInternal(const std::string &key);
+    static std::optional<std::vector<uint8_t>>
+    selectInternal(const ReadState &state, std::string_view key);
+    // Newest-wins view over every source in `state`, tombstones included.
+    // Tables with no key in [start, end) (an empty end is open) are left
+    // out, and so are tables whose filter rules out `prefix` if one is
+    // given; the caller must not read outside that range.
+    std::unique_ptr<KVIterator> newIterator(
+        const ReadState &state,
+        std::string_view start = {},
+        std::string_view end = {},
+        std::string_view prefix = {}
+    ) const;
 
 public:
-    Database(const std::string &directory, size_t memLimit, size_t sstLimit);
+    Database(
+        const std::string &directory,
+        size_t memtableBytes,
+        userver::engine::TaskProcessor &flushTaskProcessor,
+        userver::engine::TaskProcessor &compactionTaskProcessor,
+        userver::engine::TaskProcessor &fsTaskProcessor,
+        PrefixExtractor prefixExtractor = DBConfig::kPrefixExtractor
+    );
     ~Database();
 
+    // Writes return once they are durable according to the WAL sync mode
+    // and visible to readers. They throw, leaving the data unchanged, if the
+    // WAL cannot take or persist them.
     void insert(const std::string &key, const std::vector<uint8_t> &value);
+    void insert(std::string &&key, std::vector<uint8_t> &&value);
+    // False if the key is not visible; writes still being committed are
+    // not.
     bool remove(const std::string &key);
-    std::optional<std::vector<uint8_t>> select(const std::string &key);
+    std::optional<std::vector<uint8_t>> select(std::string_view key);
+
+    using ScanResult = std::vector<std::pair<std::string, std::vector<uint8_t>>>;
+    // Live entries with start <= key < end in key order, at most `limit` of
+    // them. An empty `end` means no upper bound. Throws, rather than
+    // returning partial results, if a table cannot be read.
+    ScanResult scan(std::string_view start, std::string_view end, size_t limit);
+    // Live entries whose key begins with `prefix`, starting at `from` when
+    // it is past the beginning of the prefix range.
+    ScanResult prefixScan(
+        std::string_view prefix,
+        size_t limit,
+        std::string_view from = {}
+    );
+    // Seals the active memtable and waits until every sealed memtable has
+    // been written out and its WAL segments removed.
     void flush();
+    // Starts background compaction if any level is over its budget.
     void merge();
+    BlockCache::Stats blockCacheStats() const;
+    RateLimiter::Stats backgroundIoStats() const;
+    // Throws, leaving no file behind, if a table cannot be read.
     void SnapshotCsv(const std::string &csv_path) const;
+    // Replays leftover WAL segments into the active memtable. Only safe
+    // before the database is shared, as the constructor does.
     void recoverFromWAL();
+
+private:
+    // scan() over the tables that may hold keys under `prefix`, if given;
+    // every key in [start, end) must begin with it.
+    ScanResult scanRange(
+        std::string_view start,
+        std::string_view end,
+        size_t limit,
+        std::string_view prefix
+    );
 };
 
 }  // namespace DB
@@ -0,0 +1,407 @@
+#include "database.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <userver/engine/async.hpp>
+#include <userver/engine/sleep.hpp>
+#include <userver/engine/task/current_task.hpp>
+#include <userver/fs/blocking/temp_directory.hpp>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+// Smaller than one arena block, so every write seals the memtable.
+constexpr size_t kSmallMemtable = 16 * 1024;
+// Four arena blocks: a few dozen kBigValue writes seal it.
+constexpr size_t kMediumMemtable = 256 * 1024;
+// Only flush() seals it.
+constexpr size_t kLargeMemtable = 1024 * 1024;
+constexpr size_t kBigValue = 8 * 1024;
+
+std::unique_ptr<Database> open(
+    const std::string &dir,
+    PrefixExtractor prefixExtractor = DBConfig::kPrefixExtractor,
+    size_t memtableBytes = kSmallMemtable
+) {
+    auto &tp = userver::engine::current_task::GetTaskProcessor();
+    return std::make_unique<Database>(
+        dir, memtableBytes, tp, tp, tp, prefixExtractor
+    );
+}
+
+std::vector<uint8_t> blob(const std::string &value) {
+    return std::vector<uint8_t>(value.begin(), value.end());
+}
+
+std::vector<uint8_t> bigValue(int i) {
+    return std::vector<uint8_t>(kBigValue, static_cast<uint8_t>(i));
+}
+
+std::string key(int i) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "key%05d", i);
+    return buf;
+}
+
+size_t countFiles(const std::string &dir, const std::string &prefix) {
+    size_t count = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().filename().string().rfind(prefix, 0) == 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+std::string value(int i) {
+    return std::string(160, 'a') + std::to_string(i);
+}
+
+// Polls `done` for up to 30 seconds.
+template <typename Pred>
+bool eventually(Pred done) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        userver::engine::SleepFor(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+// Three level-0 tables: "a:" and "c:" keys in each of the first two, "b:"
+// and "z:" keys in the last one. Every table overlaps the "b:" range, but
+// only the last holds keys under that prefix.
+void writeInterleavedTables(Database &db) {
+    for (int i = 0; i < 10; ++i) {
+        db.insert("a:" + std::to_string(i), blob("a"));
+        db.insert("c:" + std::to_string(i), blob("c"));
+        if (i == 4) {
+            db.flush();
+        }
+    }
+    db.flush();
+    for (int i = 0; i < 5; ++i) {
+        db.insert("b:" + std::to_string(i), blob("b"));
+    }
+    db.insert("z:0", blob("z"));
+    db.flush();
+}
+
+// Blocks read from tables by `scan`; each table here is a single block.
+template <typename Scan>
+uint64_t blocksRead(const Database &db, Scan scan) {
+    auto before = db.blockCacheStats().misses;
+    scan();
+    return db.blockCacheStats().misses - before;
+}
+
+std::vector<std::string> keysOf(const Database::ScanResult &result) {
+    std::vector<std::string> keys;
+    for (const auto &kv : result) {
+        keys.push_back(kv.first);
+    }
+    return keys;
+}
+
+// Waits until level 0 is below the compaction trigger in the manifest, i.e.
+// the compactions started by the flushes have been installed.
+void waitForCompaction(const std::string &dir) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto tables = Manifest(dir).load();
+        size_t l0 = 0;
+        for (const auto &t : tables.value_or(std::vector<TableMeta>{})) {
+            l0 += t.level == 0;
+        }
+        if (tables && l0 < DBConfig::kL0CompactionTrigger) {
+            return;
+        }
+        userver::engine::SleepFor(std::chrono::milliseconds(10));
+    }
+    FAIL() << "Compaction did not finish";
+}
+
+}  // namespace
+
+UTEST(Database, ReplaysLeftoverSegmentsInOrder) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        // Segments left behind by a run that never flushed them.
+        WAL wal(dir.GetPath());
+        wal.commit(wal.appendInsert("a", blob("1")));
+        wal.commit(wal.appendInsert("b", blob("1")));
+        wal.rotate();
+        wal.commit(wal.appendInsert("a", blob("2")));
+        wal.commit(wal.appendRemove("b"));
+        wal.rotate();
+        wal.commit(wal.appendInsert("c", blob("3")));
+    }
+    ASSERT_EQ(countFiles(dir.GetPath(), "wal_"), 3u);
+
+    auto db = open(dir.GetPath());
+    EXPECT_EQ(db->select("a"), blob("2"));
+    EXPECT_EQ(db->select("b"), std::nullopt);
+    EXPECT_EQ(db->select("c"), blob("3"));
+
+    // Once the replayed memtable is in a table, its segments are gone.
+    db->flush();
+    EXPECT_EQ(countFiles(dir.GetPath(), "wal_"), 1u);
+    EXPECT_EQ(countFiles(dir.GetPath(), "sstable_"), 1u);
+    db.reset();
+
+    db = open(dir.GetPath());
+    EXPECT_EQ(db->select("a"), blob("2"));
+    EXPECT_EQ(db->select("b"), std::nullopt);
+    EXPECT_EQ(db->select("c"), blob("3"));
+}
+
+UTEST(Database, ReopensAfterSeveralFlushes) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    constexpr int kKeys = 600;
+    auto db = open(dir.GetPath());
+    for (int i = 0; i < kKeys; ++i) {
+        db->insert(key(i), blob(value(i)));
+    }
+    // Later writes land in later segments and must win on replay.
+    for (int i = 0; i < kKeys; i += 3) {
+        db->insert(key(i), blob("updated" + std::to_string(i)));
+    }
+    for (int i = 0; i < kKeys; i += 5) {
+        db->remove(key(i));
+    }
+    // The small memtable was sealed and flushed many times over.
+    db->flush();
+    EXPECT_GT(countFiles(dir.GetPath(), "sstable_"), 1u);
+    EXPECT_EQ(countFiles(dir.GetPath(), "wal_"), 1u);
+    db.reset();
+
+    db = open(dir.GetPath());
+    size_t live = 0;
+    for (int i = 0; i < kKeys; ++i) {
+        auto found = db->select(key(i));
+        if (i % 5 == 0) {
+            EXPECT_EQ(found, std::nullopt) << key(i);
+            continue;
+        }
+        ++live;
+        if (i % 3 == 0) {
+            EXPECT_EQ(found, blob("updated" + std::to_string(i))) << key(i);
+        } else {
+            EXPECT_EQ(found, blob(value(i))) << key(i);
+        }
+    }
+    EXPECT_EQ(db->scan(key(0), {}, kKeys).size(), live);
+}
+
+UTEST(Database, UnflushedWritesSurviveReopen) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        auto db = open(dir.GetPath());
+        db->insert("flushed", blob("1"));
+        db->flush();
+        db->insert("pending", blob("2"));
+        db->remove("flushed");
+    }
+    auto db = open(dir.GetPath());
+    EXPECT_EQ(db->select("flushed"), std::nullopt);
+    EXPECT_EQ(db->select("pending"), blob("2"));
+}
+
+UTEST(Database, ReopensAfterCompaction) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    constexpr int kKeys = 600;
+    {
+        auto db = open(dir.GetPath());
+        for (int i = 0; i < kKeys; ++i) {
+            db->insert(key(i), blob(value(i)));
+        }
+        // Tombstones that must keep hiding the keys after every merge.
+        for (int i = 0; i < kKeys; i += 4) {
+            db->remove(key(i));
+        }
+        db->flush();
+        waitForCompaction(dir.GetPath());
+    }
+
+    auto listed = Manifest(dir.GetPath()).load();
+    ASSERT_TRUE(listed);
+    std::set<std::string> inManifest;
+    bool compacted = false;
+    for (const auto &t : *listed) {
+        inManifest.insert(t.file);
+        compacted = compacted || t.level > 0;
+    }
+    EXPECT_TRUE(compacted);
+    // Compaction inputs were deleted once the manifest dropped them.
+    std::set<std::string> onDisk;
+    for (const auto &entry :
+         std::filesystem::directory_iterator(dir.GetPath())) {
+        auto name = entry.path().filename().string();
+        if (name.rfind("sstable_", 0) == 0) {
+            onDisk.insert(name);
+        }
+    }
+    EXPECT_EQ(onDisk, inManifest);
+
+    auto db = open(dir.GetPath());
+    for (int i = 0; i < kKeys; ++i) {
+        if (i % 4 == 0) {
+            EXPECT_EQ(db->select(key(i)), std::nullopt) << key(i);
+        } else {
+            EXPECT_EQ(db->select(key(i)), blob(value(i))) << key(i);
+        }
+    }
+    EXPECT_EQ(db->scan({}, {}, kKeys).size(), kKeys - kKeys / 4);
+}
+
+UTEST(Database, PrefixScanSkipsTablesWithoutThePrefix) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto db = open(
+        dir.GetPath(), PrefixExtractor::delimited(':'), kLargeMemtable
+    );
+    writeInterleavedTables(*db);
+    ASSERT_EQ(countFiles(dir.GetPath(), "sstable_"), 3u);
+    db->insert("b:9", blob("b"));
+
+    Database::ScanResult found;
+    EXPECT_EQ(blocksRead(*db, [&] { found = db->prefixScan("b:", 100); }), 1u);
+    EXPECT_EQ(
+        keysOf(found),
+        (std::vector<std::string>{"b:0", "b:1", "b:2", "b:3", "b:4", "b:9"})
+    );
+
+    EXPECT_EQ(blocksRead(*db, [&] { found = db->prefixScan("a:", 100); }), 2u);
+    EXPECT_EQ(found.size(), 10u);
+
+    // Resuming inside the prefix prunes the same way.
+    EXPECT_EQ(
+        blocksRead(*db, [&] { found = db->prefixScan("b:", 100, "b:3"); }), 1u
+    );
+    EXPECT_EQ(
+        keysOf(found), (std::vector<std::string>{"b:3", "b:4", "b:9"})
+    );
+}
+
+UTEST(Database, PrefixScanReadsEveryOverlappingTableWithoutExtractor) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto db = open(
+        dir.GetPath(), PrefixExtractor::none(), kLargeMemtable
+    );
+    writeInterleavedTables(*db);
+
+    Database::ScanResult found;
+    EXPECT_EQ(blocksRead(*db, [&] { found = db->prefixScan("b:", 100); }), 3u);
+    EXPECT_EQ(found.size(), 5u);
+}
+
+UTEST(Database, RangeScanSkipsTablesOutsideTheRange) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto db = open(
+        dir.GetPath(), PrefixExtractor::none(), kLargeMemtable
+    );
+    writeInterleavedTables(*db);
+
+    Database::ScanResult found;
+    EXPECT_EQ(blocksRead(*db, [&] { found = db->scan("d", {}, 100); }), 1u);
+    EXPECT_EQ(keysOf(found), (std::vector<std::string>{"z:0"}));
+
+    EXPECT_EQ(blocksRead(*db, [&] { found = db->scan("a:", "b:", 100); }), 2u);
+    EXPECT_EQ(found.size(), 10u);
+
+    EXPECT_EQ(blocksRead(*db, [&] { found = db->scan({}, {}, 100); }), 3u);
+    EXPECT_EQ(found.size(), 26u);
+}
+
+UTEST(Database, SealsMemtableAtByteLimit) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto db = open(
+        dir.GetPath(), DBConfig::kPrefixExtractor, kMediumMemtable
+    );
+    // Well under the limit: nothing is sealed.
+    constexpr int kUnder = 8;
+    for (int i = 0; i < kUnder; ++i) {
+        db->insert(key(i), bigValue(i));
+    }
+    EXPECT_EQ(countFiles(dir.GetPath(), "wal_"), 1u);
+    EXPECT_EQ(countFiles(dir.GetPath(), "sstable_"), 0u);
+
+    // The values alone add up to more than the limit, but not to twice it.
+    constexpr int kOver = kMediumMemtable / kBigValue + 8;
+    for (int i = kUnder; i < kOver; ++i) {
+        db->insert(key(i), bigValue(i));
+    }
+    EXPECT_TRUE(eventually([&] {
+        return countFiles(dir.GetPath(), "sstable_") == 1 &&
+               countFiles(dir.GetPath(), "wal_") == 1;
+    }));
+    for (int i = 0; i < kOver; ++i) {
+        EXPECT_EQ(db->select(key(i)), bigValue(i)) << key(i);
+    }
+}
+
+UTEST(Database, WritesSlowDownThenStopUntilFlushesDrain) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto db = open(
+        dir.GetPath(), DBConfig::kPrefixExtractor, kMediumMemtable
+    );
+    // A directory where the flush writes its file makes every flush fail,
+    // so sealed memtables pile up, each keeping its WAL segment.
+    auto blocker = dir.GetPath() + "/flush.tmp";
+    std::filesystem::create_directory(blocker);
+    auto sealed = [&] { return countFiles(dir.GetPath(), "wal_") - 1; };
+    int written = 0;
+    while (sealed() < DBConfig::kImmutableSlowdownTrigger) {
+        db->insert(key(written), bigValue(written));
+        ++written;
+    }
+
+    // Past the slowdown trigger every write waits kWriteSlowdownDelay.
+    constexpr int kSlowWrites = 10;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < kSlowWrites; ++i) {
+        db->insert("slow" + std::to_string(i), blob("x"));
+    }
+    EXPECT_GE(
+        std::chrono::steady_clock::now() - started,
+        kSlowWrites * DBConfig::kWriteSlowdownDelay
+    );
+
+    while (sealed() < DBConfig::kImmutableStopTrigger) {
+        db->insert(key(written), bigValue(written));
+        ++written;
+    }
+    // At the stop trigger a write waits for the queue to drain.
+    std::atomic<bool> done{false};
+    auto writer = userver::engine::AsyncNoSpan(
+        userver::engine::current_task::GetTaskProcessor(),
+        [&] {
+            db->insert("stopped", blob("1"));
+            done = true;
+        }
+    );
+    userver::engine::SleepFor(std::chrono::milliseconds(100));
+    EXPECT_FALSE(done.load());
+    EXPECT_EQ(db->select("stopped"), std::nullopt);
+
+    // Once flushes succeed again the queue drains and the write goes on.
+    std::filesystem::remove(blocker);
+    db->flush();
+    std::move(writer).Get();
+    EXPECT_TRUE(done.load());
+    EXPECT_EQ(db->select("stopped"), blob("1"));
+    EXPECT_EQ(countFiles(dir.GetPath(), "wal_"), 1u);
+    for (int i = 0; i < written; ++i) {
+        EXPECT_EQ(db->select(key(i)), bigValue(i)) << key(i);
+    }
+}
+
+}  // namespace DB
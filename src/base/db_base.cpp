@@ -1,292 +1,856 @@
+#include <algorithm>
+#include <charconv>
 #include <chrono>
-#include <ctime>
+#include <exception>
 #include <filesystem>
 #include <fstream>
-#include <map>
-#include <sstream>
 #include <stdexcept>
+#include <userver/engine/sleep.hpp>
+#include <userver/logging/log.hpp>
+#include "../configs/db_config.hpp"
+#include "../iterator/merging_iterator.hpp"
+#include "../sstable/sstable_builder.hpp"
 #include "database.hpp"
 
 namespace {
 static std::atomic<size_t> sstableCounter{0};
+
+// Smallest string greater than every string with the given prefix, or empty
+// if there is none (the prefix is empty or all 0xff bytes).
+std::string prefixSuccessor(std::string_view prefix) {
+    std::string end(prefix);
+    while (!end.empty()) {
+        auto &c = reinterpret_cast<unsigned char &>(end.back());
+        if (c != 0xff) {
+            ++c;
+            return end;
+        }
+        end.pop_back();
+    }
+    return end;
+}
+
+// Table id encoded in an "sstable_<id>.dat" file name.
+std::optional<size_t> parseTableId(const std::string &fn) {
+    if (fn.size() <= 12 || fn.rfind("sstable_", 0) != 0 ||
+        fn.compare(fn.size() - 4, 4, ".dat") != 0)
+        return std::nullopt;
+    // Anything else that merely looks like a table, such as an out-of-range
+    // number, is not one of ours.
+    const char *begin = fn.data() + 8;
+    const char *end = fn.data() + fn.size() - 4;
+    size_t id = 0;
+    auto [ptr, ec] = std::from_chars(begin, end, id);
+    if (ec != std::errc() || ptr != end)
+        return std::nullopt;
+    return id;
 }
+}  // namespace
 
 namespace DB {
 
-Database::Database(const std::string &dir, size_t memLimit, size_t sstLimit)
-    : memtable(),
-      sstables(),
-      flushBuffer(nullptr),
-      memtableLimit(memLimit),
-      sstableLimit(sstLimit),
+Database::Database(
+    const std::string &dir,
+    size_t memBytes,
+    userver::engine::TaskProcessor &flushTaskProcessor,
+    userver::engine::TaskProcessor &compactionTaskProcessor,
+    userver::engine::TaskProcessor &fsTaskProcessor,
+    PrefixExtractor prefixExtractor
+)
+    : state_(ReadState{
+          std::make_shared<MemTable>(),
+          {},
+          LevelTables(DBConfig::kNumLevels)}),
+      memtableBytes(memBytes),
       directory(dir),
-      wal_(directory + "/wal.log"),
+      blockCache_(std::make_shared<BlockCache>(
+          DBConfig::kBlockCacheBytes,
+          DBConfig::kBlockCacheShards
+      )),
+      backgroundIo_(
+          DBConfig::kBackgroundIoBytesPerSec,
+          DBConfig::kBackgroundIoMinBytesPerSec,
+          DBConfig::kBackgroundIoMaxBytesPerSec,
+          DBConfig::kForegroundLatencyTarget
+      ),
+      wal_(directory, DBConfig::kWalSyncMode, DBConfig::kWalSyncInterval),
+      manifest_(directory),
       db_mutex(),
-      mergeInProgress(false) {
+      compactionInProgress_(false),
+      compactionPolicy_(makeCompactionPolicy(DBConfig::kCompactionStyle)),
+      prefixExtractor_(prefixExtractor),
+      flushTaskProcessor_(flushTaskProcessor),
+      fsTaskProcessor_(fsTaskProcessor),
+      compactionTaskProcessor_(compactionTaskProcessor) {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d)
+            .count();
+    };
+    auto started = Clock::now();
     std::filesystem::create_directories(directory);
     recoverFromWAL();
+    auto walDone = Clock::now();
     loadSSTables();
+    auto tablesDone = Clock::now();
+    auto state = state_.Read();
+    size_t tables = 0;
+    for (const auto &level : state->levels)
+        tables += level.size();
+    LOG_INFO() << "Database opened in " << ms(tablesDone - started)
+               << " ms: WAL replay " << ms(walDone - started) << " ms ("
+               << state->memtable->size() << " keys), SSTable load "
+               << ms(tablesDone - walDone) << " ms (" << tables << " tables)";
+    std::lock_guard<userver::engine::Mutex> lock(db_mutex);
+    scheduleCompaction();
 }
 
 Database::~Database() {
-    std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-    if (!memtable.empty()) {
-        flushMemtable();
-    }
+    flush();
+    compactionTasks_.CancelAndWait();
+    if (flushTask_.IsValid())
+        flushTask_.Wait();
 }
 
 void Database::recoverFromWAL() {
-    wal_.recover([this](
-                     const std::string &key, const std::vector<uint8_t> &blob,
+    // Nothing else can see the database yet, so records go straight into a
+    // private memtable that is published once at the end.
+    auto memtable = std::make_shared<MemTable>();
+    auto stats = wal_.recover([&memtable](
+                     std::string &&key, std::vector<uint8_t> &&blob,
                      bool tombstone
                  ) {
-        std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        memtable.insert(key, {blob, tombstone});
+        memtable->insert_or_assign(
+            std::move(key), DBEntry{std::move(blob), tombstone}
+        );
     });
+    if (stats.discardedBytes > 0) {
+        LOG_WARNING() << "WAL recovery replayed " << stats.records
+                      << " records from " << stats.segments
+                      << " segments and discarded " << stats.discardedBytes
+                      << " bytes of torn or corrupt tail, including "
+                      << stats.droppedSegments << " later segments";
+    }
+    if (memtable->empty())
+        return;
+    std::lock_guard<userver::engine::Mutex> lock(db_mutex);
+    auto state = state_.StartWrite();
+    state->memtable = std::move(memtable);
+    state.Commit();
 }
 
 void Database::loadSSTables() {
     namespace fs = std::filesystem;
     if (!fs::exists(directory))
         return;
-    size_t maxId = 0;
+    std::vector<std::pair<size_t, std::string>> found;
     for (auto &entry : fs::directory_iterator(directory)) {
-        auto path = entry.path().string();
-        if (entry.is_regular_file() && entry.path().extension() == ".dat" &&
-            path.find("sstable_") != std::string::npos) {
-            sstables.emplace_back(std::make_shared<SSTable>(path));
-            auto fn = entry.path().filename().string();
-            auto p1 = fn.find("sstable_");
-            auto p2 = fn.rfind(".dat");
-            if (p1 != std::string::npos && p2 != std::string::npos &&
-                p2 > p1 + 8) {
-                try {
-                    size_t id = std::stoull(fn.substr(p1 + 8, p2 - (p1 + 8)));
-                    maxId = std::max(maxId, id);
-                } catch (...) {
-                }
+        auto fn = entry.path().filename().string();
+        // A flush interrupted before publishing; its WAL segments remain.
+        if (fn == "flush.tmp" || fn == "MANIFEST.tmp") {
+            std::error_code ec;
+            fs::remove(entry.path(), ec);
+            continue;
+        }
+        if (!entry.is_regular_file() || fn.rfind("sstable_", 0) != 0)
+            continue;
+        auto id = parseTableId(fn);
+        if (!id) {
+            LOG_WARNING() << "Ignoring unexpected table file " << fn;
+            continue;
+        }
+        found.emplace_back(*id, fn);
+    }
+    std::sort(found.begin(), found.end());
+    sstableCounter.store(found.empty() ? 0 : found.back().first + 1);
+
+    auto listed = manifest_.load();
+    std::vector<TableMeta> tables;
+    if (listed) {
+        tables = std::move(*listed);
+        // Outputs of a compaction or flush that crashed before the manifest
+        // took them in; their data is still in the inputs or the WAL.
+        for (const auto &f : found) {
+            bool live = std::any_of(
+                tables.begin(), tables.end(),
+                [&f](const TableMeta &t) { return t.file == f.second; }
+            );
+            if (!live) {
+                LOG_WARNING() << "Removing table " << f.second
+                              << " missing from the manifest";
+                std::error_code ec;
+                fs::remove(directory + "/" + f.second, ec);
             }
         }
+    } else {
+        // Written before tables had levels: ids grow with age, so they
+        // form level 0 oldest first.
+        for (const auto &f : found) {
+            TableMeta meta;
+            meta.file = f.second;
+            tables.push_back(std::move(meta));
+        }
     }
-    sstableCounter.store(maxId + 1);
-}
 
-void Database::flushMemtable() {
-    auto toFlush = std::make_unique<SkipListMap<std::string, DBEntry>>();
+    // Opening a table reads its filter and index; do that for all tables at
+    // once on the blocking-I/O processor.
+    std::vector<userver::engine::TaskWithResult<std::shared_ptr<SSTable>>>
+        tasks;
+    tasks.reserve(tables.size());
+    for (const auto &t : tables) {
+        if (t.level >= DBConfig::kNumLevels)
+            throw std::runtime_error(
+                "Table " + t.file + " is at level " + std::to_string(t.level) +
+                ", beyond kNumLevels"
+            );
+        if (!fs::exists(directory + "/" + t.file))
+            throw std::runtime_error(
+                "Table " + t.file + " listed in the manifest is missing"
+            );
+        tasks.push_back(userver::engine::AsyncNoSpan(
+            fsTaskProcessor_,
+            [this, path = directory + "/" + t.file] {
+                return std::make_shared<SSTable>(path, blockCache_);
+            }
+        ));
+    }
+    LevelTables levels(DBConfig::kNumLevels);
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        auto table = std::move(tasks[i]).Get();
+        if (listed && table->fileSize() != tables[i].fileSize)
+            throw std::runtime_error(
+                "Table " + tables[i].file + " does not match the manifest"
+            );
+        levels[tables[i].level].push_back(std::move(table));
+    }
+
+    std::pair<uint64_t, std::vector<TableMeta>> snapshot;
     {
         std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        for (auto it = memtable.begin(); it != memtable.end(); ++it) {
-            auto kv = *it;
-            toFlush->insert(kv.first, kv.second);
+        auto state = state_.StartWrite();
+        state->levels = std::move(levels);
+        snapshot = manifestSnapshot(*state);
+        state.Commit();
+    }
+    if (!listed && !persistManifest(snapshot.first, snapshot.second))
+        throw std::runtime_error("Cannot create manifest in " + directory);
+}
+
+void Database::sealMemtable(std::unique_lock<userver::engine::Mutex> &lock) {
+    userver::engine::TaskCancellationBlocker blocker;
+    if (sealing_) {
+        // Another writer is sealing; nothing can be appended until it is
+        // done, so its seal covers everything this caller wrote.
+        writesApplied_.Wait(lock, [this] { return !sealing_; });
+        return;
+    }
+    // A write appended but not yet applied would go into the next memtable
+    // while its record stays in the segment closed below, which is removed
+    // once this memtable is flushed.
+    sealing_ = true;
+    writesApplied_.Wait(lock, [this] { return appliedSeq_ == appendedSeq_; });
+    sealing_ = false;
+    writesApplied_.NotifyAll();
+
+    auto state = state_.StartWrite();
+    if (state->memtable->empty())
+        return;
+    // New writes go to a fresh segment; the closed ones now belong to the
+    // sealed memtable and live until its SSTable is durable.
+    immutableSegments_.push_back(wal_.rotate());
+    state->immutables.push_back(std::move(state->memtable));
+    state->memtable = std::make_shared<MemTable>();
+    state.Commit();
+    scheduleFlush();
+}
+
+void Database::scheduleFlush() {
+    if (flushScheduled_)
+        return;
+    flushScheduled_ = true;
+    flushTask_ = userver::engine::CriticalAsyncNoSpan(
+        flushTaskProcessor_, [this] { flushWorker(); }
+    );
+}
+
+void Database::flushWorker() {
+    while (true) {
+        std::shared_ptr<MemTable> toFlush;
+        {
+            std::lock_guard<userver::engine::Mutex> lock(db_mutex);
+            auto state = state_.Read();
+            if (state->immutables.empty()) {
+                flushScheduled_ = false;
+                tablesChanged_.NotifyAll();
+                return;
+            }
+            toFlush = state->immutables.front();
+        }
+        auto tmpPath = directory + "/flush.tmp";
+        // Set once the table is renamed into place and cleared once it is
+        // published; a failure in between removes it.
+        std::string unpublished;
+        try {
+            std::filesystem::create_directories(directory);
+            {
+                SSTable writer(tmpPath);
+                writer.write(*toFlush, &backgroundIo_, prefixExtractor_);
+            }
+            auto path = directory + "/sstable_" +
+                        std::to_string(sstableCounter++) + ".dat";
+            std::filesystem::rename(tmpPath, path);
+            unpublished = path;
+            // Opened before db_mutex is taken, so a table that cannot be
+            // read never reaches the level list.
+            auto table = std::make_shared<SSTable>(path, blockCache_);
+
+            uint64_t segment = 0;
+            std::pair<uint64_t, std::vector<TableMeta>> snapshot;
+            {
+                std::lock_guard<userver::engine::Mutex> lock(db_mutex);
+                auto state = state_.StartWrite();
+                state->levels[0].push_back(std::move(table));
+                state->immutables.erase(state->immutables.begin());
+                snapshot = manifestSnapshot(*state);
+                state.Commit();
+                unpublished.clear();
+                segment = immutableSegments_.front();
+                immutableSegments_.erase(immutableSegments_.begin());
+                tablesChanged_.NotifyAll();
+                scheduleCompaction();
+            }
+            // The table data was synced by SSTable::write; once the manifest
+            // lists it, the segments are redundant. Otherwise they are
+            // removed together with a later flush's, and until then a
+            // restart replays them and drops the unlisted table.
+            if (persistManifest(snapshot.first, snapshot.second))
+                wal_.removeSegmentsUpTo(segment);
+        } catch (const std::exception &e) {
+            // Unless it was published, the memtable stays queued and
+            // readable; the next seal or stalled write retries.
+            LOG_ERROR() << "Flush in " << directory << " failed: " << e.what();
+            if (!unpublished.empty()) {
+                std::error_code ec;
+                std::filesystem::remove(unpublished, ec);
+            }
+            std::lock_guard<userver::engine::Mutex> lock(db_mutex);
+            flushScheduled_ = false;
+            tablesChanged_.NotifyAll();
+            return;
         }
-        memtable.clear();
-        flushBuffer = std::move(toFlush);
     }
-    std::filesystem::create_directories(directory);
-    size_t id = sstableCounter++;
-    auto path = directory + "/sstable_" + std::to_string(id) + ".dat";
-    {
-        SSTable writer(path);
-        writer.write(*flushBuffer);
+}
+
+void Database::scheduleCompaction() {
+    if (!compactionInProgress_.exchange(true)) {
+        compactionTasks_.Detach(userver::engine::CriticalAsyncNoSpan(
+            compactionTaskProcessor_, [this] { compactionWorker(); }
+        ));
     }
-    {
-        std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        sstables.emplace_back(std::make_shared<SSTable>(path));
-        flushBuffer.reset();
-        wal_.clear();
-        if (sstables.size() > sstableLimit && !mergeInProgress.exchange(true)) {
-            userver::engine::CriticalAsyncNoSpan([this] { mergeWorker(); }
-            ).Detach();
+}
+
+std::pair<uint64_t, std::vector<TableMeta>> Database::manifestSnapshot(
+    const ReadState &state
+) {
+    std::vector<TableMeta> tables;
+    for (size_t level = 0; level < state.levels.size(); ++level) {
+        for (const auto &sst : state.levels[level]) {
+            TableMeta meta;
+            meta.level = static_cast<int>(level);
+            meta.file = std::filesystem::path(sst->getFilename())
+                            .filename()
+                            .string();
+            meta.fileSize = sst->fileSize();
+            meta.smallestKey = std::string(sst->smallestKey());
+            meta.largestKey = std::string(sst->largestKey());
+            tables.push_back(std::move(meta));
         }
     }
+    return {++manifestVersion_, std::move(tables)};
 }
 
-void Database::mergeWorker() {
-    userver::engine::current_task::CancellationPoint();
-    std::vector<std::shared_ptr<SSTable>> old_list;
-    {
-        std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        old_list = sstables;
+bool Database::persistManifest(
+    uint64_t version,
+    const std::vector<TableMeta> &tables
+) {
+    std::lock_guard<userver::engine::Mutex> lock(manifestMutex_);
+    // Versions are cumulative, so a newer one already covers this change.
+    if (version <= manifestWritten_)
+        return true;
+    try {
+        manifest_.save(tables);
+    } catch (const std::exception &e) {
+        LOG_ERROR() << "Manifest update failed: " << e.what();
+        return false;
     }
-    SkipListMap<std::string, DBEntry> merged;
-    std::vector<std::string> oldFiles;
-    for (const auto &sst : old_list) {
-        userver::engine::current_task::CancellationPoint();
-        auto dumpMap = sst->dump();
-        for (const auto &p : dumpMap)
-            merged.insert(p.first, p.second);
-        oldFiles.push_back(sst->getFilename());
+    manifestWritten_ = version;
+    return true;
+}
+
+void Database::delayWrite(std::unique_lock<userver::engine::Mutex> &lock) {
+    auto mustStop = [this] {
+        auto state = state_.Read();
+        return state->immutables.size() >= DBConfig::kImmutableStopTrigger ||
+               state->levels[0].size() >= DBConfig::kL0StopTrigger;
+    };
+    if (mustStop()) {
+        LOG_WARNING() << "Stopping writes until flush and compaction catch up";
+        // Restart background work in case an earlier attempt failed.
+        if (!state_.Read()->immutables.empty())
+            scheduleFlush();
+        scheduleCompaction();
+        if (!tablesChanged_.Wait(lock, [&] { return !mustStop(); }))
+            throw std::runtime_error("Write cancelled while stalled");
     }
-    std::vector<std::string> keysToRemove;
-    for (auto it = merged.begin(); it != merged.end(); ++it) {
-        auto kv = *it;
-        if (kv.second.tombstone) {
-            keysToRemove.push_back(kv.first);
-        }
+    auto state = state_.Read();
+    if (state->immutables.size() >= DBConfig::kImmutableSlowdownTrigger ||
+        state->levels[0].size() >= DBConfig::kL0SlowdownTrigger) {
+        lock.unlock();
+        userver::engine::SleepFor(DBConfig::kWriteSlowdownDelay);
+        lock.lock();
     }
+    if (!writesApplied_.Wait(lock, [this] { return !sealing_; }))
+        throw std::runtime_error("Write cancelled while stalled");
+}
 
-    for (const auto &k : keysToRemove) {
-        merged.erase(k);
+void Database::compactionWorker() {
+    while (true) {
+        std::optional<CompactionJob> job;
+        {
+            std::lock_guard<userver::engine::Mutex> lock(db_mutex);
+            job = compactionPolicy_->pick(state_.Read()->levels);
+            if (!job) {
+                compactionInProgress_.store(false);
+                tablesChanged_.NotifyAll();
+                return;
+            }
+        }
+        bool done = false;
+        try {
+            done = runCompaction(*job);
+        } catch (const std::exception &e) {
+            LOG_ERROR() << "Compaction of level " << job->level
+                        << " failed: " << e.what();
+        } catch (...) {
+            // Cancelled; the worker stops below all the same.
+        }
+        if (!done) {
+            // Retried by the next flush or stalled write.
+            std::lock_guard<userver::engine::Mutex> lock(db_mutex);
+            compactionInProgress_.store(false);
+            tablesChanged_.NotifyAll();
+            return;
+        }
     }
+}
+
+bool Database::runCompaction(const CompactionJob &job) {
     userver::engine::current_task::CancellationPoint();
-    std::ostringstream oss;
-    oss << directory << "/sstable_" << std::time(nullptr) << ".dat";
-    SSTable newSST(oss.str());
-    newSST.write(merged);
+    uint64_t inputBytes = 0;
+    for (const auto &sst : job.inputs)
+        inputBytes += sst->fileSize();
+
+    std::vector<std::shared_ptr<SSTable>> outputTables;
+    size_t parts = 1;
+    if (job.trivialMove) {
+        outputTables = job.inputs;
+    } else {
+        // Only jobs that may produce several tables can be split; a
+        // size-tiered run stays a single table.
+        std::vector<std::string> splits;
+        if (job.targetFileBytes > 0) {
+            parts = std::min<uint64_t>(
+                DBConfig::kMaxSubcompactions,
+                inputBytes / DBConfig::kMinSubcompactionBytes
+            );
+            splits = subcompactionSplits(job, parts);
+        }
+        parts = splits.size() + 1;
+
+        std::vector<userver::engine::TaskWithResult<std::vector<std::string>>>
+            tasks;
+        for (size_t i = 0; i < parts; ++i) {
+            std::string start = i == 0 ? std::string() : splits[i - 1];
+            std::string end = i == splits.size() ? std::string() : splits[i];
+            tasks.push_back(userver::engine::AsyncNoSpan(
+                compactionTaskProcessor_,
+                [this, &job, start = std::move(start), end = std::move(end)] {
+                    return compactRange(job, start, end);
+                }
+            ));
+        }
+        // Every subcompaction is waited for, so none is still writing when
+        // a failed job's outputs are removed.
+        std::vector<std::string> outputs;
+        std::string error;
+        for (auto &task : tasks) {
+            try {
+                auto paths = std::move(task).Get();
+                outputs.insert(outputs.end(), paths.begin(), paths.end());
+            } catch (const std::exception &e) {
+                if (error.empty())
+                    error = e.what();
+            }
+        }
+        try {
+            if (!error.empty())
+                throw std::runtime_error(error);
+            for (const auto &path : outputs) {
+                outputTables.push_back(
+                    std::make_shared<SSTable>(path, blockCache_)
+                );
+            }
+        } catch (const std::exception &e) {
+            LOG_ERROR() << "Compaction of level " << job.level
+                        << " failed: " << e.what();
+            outputTables.clear();
+            for (const auto &path : outputs) {
+                std::error_code ec;
+                std::filesystem::remove(path, ec);
+            }
+            return false;
+        }
+    }
+
+    // All subcompactions are installed together under one manifest version.
+    std::pair<uint64_t, std::vector<TableMeta>> snapshot;
     {
         std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        for (const auto &fn : oldFiles)
-            std::filesystem::remove(fn);
-        std::vector<std::shared_ptr<SSTable>> survivors;
-        for (const auto &sst : sstables) {
-            bool keep = true;
-            for (auto &of : oldFiles)
-                if (sst->getFilename() == of) {
-                    keep = false;
-                    break;
-                }
-            if (keep)
-                survivors.emplace_back(sst);
+        auto state = state_.StartWrite();
+        compactionPolicy_->install(state->levels, job, outputTables);
+        snapshot = manifestSnapshot(*state);
+        state.Commit();
+        tablesChanged_.NotifyAll();
+    }
+    // Inputs are deleted only once the manifest no longer lists them; if
+    // it cannot be written they are left for the next startup to clean up.
+    if (persistManifest(snapshot.first, snapshot.second)) {
+        for (const auto &sst : job.inputs) {
+            if (std::find(outputTables.begin(), outputTables.end(), sst) ==
+                outputTables.end())
+                sst->markObsolete();
+        }
+    }
+    uint64_t outputBytes = 0;
+    for (const auto &sst : outputTables)
+        outputBytes += sst->fileSize();
+    LOG_INFO() << (job.trivialMove ? "Moved " : "Compacted ")
+               << job.inputs.size() << " tables (" << inputBytes
+               << " bytes) from level " << job.level << " into "
+               << outputTables.size() << " tables (" << outputBytes
+               << " bytes) at level " << job.outputLevel << " in " << parts
+               << " subcompactions, score " << job.score;
+    return true;
+}
+
+std::vector<std::string> Database::compactRange(
+    const CompactionJob &job,
+    std::string_view start,
+    std::string_view end
+) {
+    std::vector<std::unique_ptr<KVIterator>> children;
+    for (const auto &sst : job.inputs)
+        children.push_back(sst->newIterator(&backgroundIo_));
+    MergingIterator merged(std::move(children));
+
+    std::vector<std::string> outputs;
+    size_t entries = 0;
+    try {
+        std::unique_ptr<SSTableBuilder> builder;
+        auto finishOutput = [&] {
+            builder->finish();
+            outputs.push_back(builder->filename());
+            builder.reset();
+        };
+        // The merging iterator already yields only the newest version of
+        // each key, so shadowed versions never reach the output.
+        for (merged.seek(start); merged.valid(); merged.next()) {
+            if (!end.empty() && merged.key() >= end)
+                break;
+            if (++entries % 1024 == 0)
+                userver::engine::current_task::CancellationPoint();
+            const auto &entry = merged.entry();
+            if (entry.tombstone && job.dropTombstones)
+                continue;
+            if (builder && job.targetFileBytes > 0 &&
+                builder->fileSize() >= job.targetFileBytes)
+                finishOutput();
+            if (!builder) {
+                builder = std::make_unique<SSTableBuilder>(
+                    directory + "/sstable_" +
+                        std::to_string(sstableCounter++) + ".dat",
+                    &backgroundIo_,
+                    DBConfig::kFilterTypeByLevel[job.outputLevel],
+                    prefixExtractor_
+                );
+            }
+            builder->add(merged.key(), entry);
+        }
+        // Dropping the unreadable keys would lose them for good once the
+        // inputs are deleted, and could resurrect what their tombstones
+        // hid.
+        if (!merged.ok())
+            throw std::runtime_error("Cannot read compaction input");
+        if (builder)
+            finishOutput();
+    } catch (...) {
+        for (const auto &path : outputs) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
         }
-        survivors.emplace_back(std::make_shared<SSTable>(newSST.getFilename()));
-        sstables = std::move(survivors);
-        mergeInProgress.store(false);
+        throw;
     }
+    return outputs;
 }
 
 std::optional<std::vector<uint8_t>> Database::selectInternal(
-    const std::string &key
+    const ReadState &state,
+    std::string_view key
 ) {
     {
-        auto *vPtr = memtable.find(key);
+        auto *vPtr = state.memtable->find(key);
         if (vPtr) {
             if (vPtr->tombstone)
                 return std::nullopt;
             return vPtr->value;
         }
-        if (flushBuffer) {
-            auto *fbPtr = flushBuffer->find(key);
-            if (fbPtr) {
-                if (fbPtr->tombstone)
+        for (auto it = state.immutables.rbegin();
+             it != state.immutables.rend(); ++it) {
+            auto *imPtr = (*it)->find(key);
+            if (imPtr) {
+                if (imPtr->tombstone)
                     return std::nullopt;
-                return fbPtr->value;
+                return imPtr->value;
             }
         }
     }
-    for (auto it = sstables.rbegin(); it != sstables.rend(); ++it) {
-        DBEntry e;
-        if ((*it)->find(key, e)) {
-            if (e.tombstone)
-                return std::nullopt;
-            return e.value;
-        }
+    ValueRef ref;
+    bool found = false;
+    const auto &l0 = state.levels[0];
+    for (auto it = l0.rbegin(); it != l0.rend() && !found; ++it)
+        found = (*it)->get(key, ref);
+    // Deeper levels have disjoint ranges sorted by key: at most one table
+    // per level can hold the key.
+    for (size_t level = 1; level < state.levels.size() && !found; ++level) {
+        const auto &tables = state.levels[level];
+        auto it = std::lower_bound(
+            tables.begin(), tables.end(), key,
+            [](const std::shared_ptr<SSTable> &t, std::string_view k) {
+                return t->largestKey() < k;
+            }
+        );
+        if (it != tables.end() && (*it)->smallestKey() <= key)
+            found = (*it)->get(key, ref);
     }
+    if (found && !ref.tombstone)
+        return std::vector<uint8_t>(ref.value.begin(), ref.value.end());
     return std::nullopt;
 }
 
+std::unique_ptr<KVIterator> Database::newIterator(
+    const ReadState &state,
+    std::string_view start,
+    std::string_view end,
+    std::string_view prefix
+) const {
+    std::vector<std::unique_ptr<KVIterator>> children;
+    children.push_back(std::make_unique<MemTableIterator>(state.memtable));
+    for (auto it = state.immutables.rbegin(); it != state.immutables.rend();
+         ++it) {
+        children.push_back(std::make_unique<MemTableIterator>(*it));
+    }
+    auto wanted = [&](const SSTable &sst) {
+        return sst.overlaps(start, end) &&
+               (prefix.empty() ||
+                sst.mayContainPrefix(prefixExtractor_, prefix));
+    };
+    const auto &l0 = state.levels[0];
+    for (auto it = l0.rbegin(); it != l0.rend(); ++it) {
+        if (wanted(**it))
+            children.push_back((*it)->newIterator());
+    }
+    // Deeper levels are sorted and disjoint: only a run of tables starting
+    // at the first one that ends at or after `start` can overlap.
+    for (size_t level = 1; level < state.levels.size(); ++level) {
+        const auto &tables = state.levels[level];
+        auto it = std::lower_bound(
+            tables.begin(), tables.end(), start,
+            [](const std::shared_ptr<SSTable> &t, std::string_view k) {
+                return t->largestKey() < k;
+            }
+        );
+        for (; it != tables.end() &&
+               (end.empty() || (*it)->smallestKey() < end);
+             ++it) {
+            if (wanted(**it))
+                children.push_back((*it)->newIterator());
+        }
+    }
+    return std::make_unique<MergingIterator>(std::move(children));
+}
+
 void Database::insert(
     const std::string &key,
     const std::vector<uint8_t> &value
 ) {
-    bool need = false;
+    insert(std::string(key), std::vector<uint8_t>(value));
+}
+
+void Database::insert(std::string &&key, std::vector<uint8_t> &&value) {
+    uint64_t seq = 0;
     {
-        std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        wal_.logInsert(key, value);
-        memtable.insert(key, {value, false});
-        need = (memtable.size() >= memtableLimit);
+        std::unique_lock<userver::engine::Mutex> lock(db_mutex);
+        delayWrite(lock);
+        seq = wal_.appendInsert(key, value);
+        appendedSeq_ = seq;
     }
-    if (need)
-        flushMemtable();
+    applyCommitted(seq, std::move(key), DBEntry{std::move(value), false});
 }
 
 bool Database::remove(const std::string &key) {
-    bool existed = false, need = false;
+    uint64_t seq = 0;
     {
-        std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        auto prev = selectInternal(key);
+        std::unique_lock<userver::engine::Mutex> lock(db_mutex);
+        delayWrite(lock);
+        auto prev = selectInternal(*state_.Read(), key);
         if (!prev.has_value())
             return false;
-        wal_.logRemove(key);
-        memtable.insert(key, {{}, true});
-        existed = true;
-        need = (memtable.size() >= memtableLimit);
+        seq = wal_.appendRemove(key);
+        appendedSeq_ = seq;
     }
-    if (need)
-        flushMemtable();
-    return existed;
+    applyCommitted(seq, std::string(key), DBEntry{{}, true});
+    return true;
 }
 
-std::optional<std::vector<uint8_t>> Database::select(const std::string &key) {
-    std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-    return selectInternal(key);
+void Database::applyCommitted(
+    uint64_t seq,
+    std::string &&key,
+    DBEntry &&entry
+) {
+    // Once appended, the write must take its turn below even if the caller
+    // is cancelled, or every later writer would wait for it forever.
+    userver::engine::TaskCancellationBlocker blocker;
+    std::exception_ptr error;
+    try {
+        // Outside db_mutex so concurrent writers share one WAL write and
+        // sync.
+        wal_.commit(seq);
+    } catch (const std::exception &) {
+        error = std::current_exception();
+    }
+    std::unique_lock<userver::engine::Mutex> lock(db_mutex);
+    // Applying in log order keeps the memtable equal to a replay of the log
+    // when two writers race on the same key.
+    writesApplied_.Wait(lock, [&] { return appliedSeq_ + 1 == seq; });
+    bool full = false;
+    if (!error) {
+        auto state = state_.Read();
+        state->memtable->insert_or_assign(std::move(key), std::move(entry));
+        full = state->memtable->approximateMemoryUsage() >= memtableBytes;
+    }
+    appliedSeq_ = seq;
+    writesApplied_.NotifyAll();
+    if (error)
+        std::rethrow_exception(error);
+    if (full)
+        sealMemtable(lock);
+}
+
+std::optional<std::vector<uint8_t>> Database::select(std::string_view key) {
+    auto started = std::chrono::steady_clock::now();
+    auto state = state_.Read();
+    auto result = selectInternal(*state, key);
+    backgroundIo_.recordForegroundLatency(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started
+        )
+    );
+    return result;
+}
+
+Database::ScanResult
+Database::scan(std::string_view start, std::string_view end, size_t limit) {
+    return scanRange(start, end, limit, {});
+}
+
+Database::ScanResult Database::scanRange(
+    std::string_view start,
+    std::string_view end,
+    size_t limit,
+    std::string_view prefix
+) {
+    auto started = std::chrono::steady_clock::now();
+    ScanResult result;
+    auto state = state_.Read();
+    auto it = newIterator(*state, start, end, prefix);
+    for (it->seek(start); it->valid() && result.size() < limit; it->next()) {
+        if (!end.empty() && it->key() >= end)
+            break;
+        const auto &e = it->entry();
+        if (!e.tombstone)
+            result.emplace_back(std::string(it->key()), e.value);
+    }
+    if (!it->ok())
+        throw std::runtime_error("Cannot read SSTable during scan");
+    backgroundIo_.recordForegroundLatency(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started
+        )
+    );
+    return result;
+}
+
+Database::ScanResult Database::prefixScan(
+    std::string_view prefix,
+    size_t limit,
+    std::string_view from
+) {
+    std::string end = prefixSuccessor(prefix);
+    std::string_view start = std::max(prefix, from);
+    if (!end.empty() && start >= end)
+        return {};
+    return scanRange(start, end, limit, prefix);
 }
 
 void Database::flush() {
-    std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-    if (!memtable.empty())
-        flushMemtable();
+    std::unique_lock<userver::engine::Mutex> lock(db_mutex);
+    sealMemtable(lock);
+    if (!state_.Read()->immutables.empty())
+        scheduleFlush();
+    // The worker stops once the queue is empty, after dropping the WAL
+    // segments of what it flushed, or early if it gave up after a failed
+    // write.
+    tablesChanged_.Wait(lock, [this] { return !flushScheduled_; });
 }
 
 void Database::merge() {
     std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-    if (!mergeInProgress.exchange(true)) {
-        userver::engine::CriticalAsyncNoSpan([this] { mergeWorker(); }
-        ).Detach();
-    }
+    scheduleCompaction();
+}
+
+BlockCache::Stats Database::blockCacheStats() const {
+    return blockCache_->stats();
+}
+
+RateLimiter::Stats Database::backgroundIoStats() const {
+    return backgroundIo_.stats();
 }
 
 void Database::SnapshotCsv(const std::string &csv_path) const {
-    std::vector<std::shared_ptr<SSTable>> sst_copy;
-    SkipListMap<std::string, DBEntry> mem_copy;
-    std::unique_ptr<SkipListMap<std::string, DBEntry>> flush_copy;
-    {
-        std::lock_guard<userver::engine::Mutex> lock(db_mutex);
-        for (auto it = memtable.begin(); it != memtable.end(); ++it) {
-            auto p = *it;
-            mem_copy.insert(p.first, p.second);
-        }
-        if (flushBuffer) {
-            flush_copy = std::make_unique<SkipListMap<std::string, DBEntry>>();
-            for (auto it = flushBuffer->begin(); it != flushBuffer->end();
-                 ++it) {
-                auto p = *it;
-                flush_copy->insert(p.first, p.second);
-            }
-        }
-        sst_copy = sstables;
-    }
-    std::map<std::string, DBEntry> full_map;
-    for (auto it = mem_copy.begin(); it != mem_copy.end(); ++it) {
-        auto p = *it;
-        full_map[p.first] = p.second;
-    }
-    if (flush_copy) {
-        for (auto it = flush_copy->begin(); it != flush_copy->end(); ++it) {
-            auto p = *it;
-            full_map[p.first] = p.second;
-        }
-    }
-    for (auto &sst : sst_copy) {
-        auto dm = sst->dump();
-        for (auto &p : dm)
-            full_map[p.first] = p.second;
-    }
-    for (auto it = full_map.begin(); it != full_map.end();) {
-        if (it->second.tombstone)
-            it = full_map.erase(it);
-        else
-            ++it;
-    }
+    auto state = state_.Read();
     std::ofstream out(csv_path);
     if (!out)
         throw std::runtime_error("Cannot open CSV");
     out << "key,value\n";
-    for (auto &pr : full_map) {
-        const auto &key = pr.first;
-        const auto &e = pr.second;
-        std::string v(e.value.begin(), e.value.end());
-        out << key << ",\"";
-        for (char c : v) {
+    // Streams the merged view, so memory does not grow with the data.
+    auto it = newIterator(*state);
+    for (it->seekToFirst(); it->valid(); it->next()) {
+        const auto &e = it->entry();
+        if (e.tombstone)
+            continue;
+        out << it->key() << ",\"";
+        for (uint8_t b : e.value) {
+            char c = static_cast<char>(b);
             if (c == '"')
                 out << "\"\"";
             else
@@ -294,6 +858,12 @@ void Database::SnapshotCsv(const std::string &csv_path) const {
         }
         out << "\"\n";
     }
+    if (!it->ok()) {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(csv_path, ec);
+        throw std::runtime_error("Cannot read SSTable during snapshot");
+    }
 }
 
-}  // namespace DB
\ No newline at end of file
+}  // namespace DB
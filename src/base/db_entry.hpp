@@ -1,8 +1,10 @@
 #ifndef DB_ENTRY_HPP_
 #define DB_ENTRY_HPP_
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
+#include "../skiplist/heap_bytes.hpp"
 
 namespace DB {
 
@@ -11,6 +13,10 @@ struct DBEntry {
     bool tombstone = false;
 };
 
+inline std::size_t heapBytes(const DBEntry &e) {
+    return ::heapBytes(e.value);
+}
+
 }  // namespace DB
 
 #endif  // DB_ENTRY_HPP_
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef MEMTABLE_HPP_
+#define MEMTABLE_HPP_
+
+#include <memory>
+#include <string>
+#include "../iterator/kv_iterator.hpp"
+#include "../skiplist/concurrent_skiplist.hpp"
+#include "db_entry.hpp"
+
+namespace DB {
+
+// Active write buffer: one writer at a time (under Database::db_mutex),
+// lock-free readers.
+using MemTable = ConcurrentSkipListMap<std::string, DBEntry>;
+
+// Keeps the memtable alive for as long as the iterator exists. Entries
+// inserted concurrently may or may not be observed.
+class MemTableIterator : public KVIterator {
+public:
+    explicit MemTableIterator(std::shared_ptr<const MemTable> table)
+        : table_(std::move(table)), it_(table_->end()) {
+    }
+
+    bool valid() const override {
+        return it_ != table_->end();
+    }
+
+    void seekToFirst() override {
+        it_ = table_->begin();
+    }
+
+    void seek(std::string_view target) override {
+        it_ = table_->lower_bound(target);
+    }
+
+    void next() override {
+        ++it_;
+    }
+
+    std::string_view key() const override {
+        return (*it_).first;
+    }
+
+    const DBEntry &entry() const override {
+        return (*it_).second;
+    }
+
+private:
+    std::shared_ptr<const MemTable> table_;
+    MemTable::iterator it_;
+};
+
+}  // namespace DB
+
+#endif  // MEMTABLE_HPP_
@@ -1,35 +1,79 @@
 #ifndef BLOOM_FILTER_HPP_
 #define BLOOM_FILTER_HPP_
 
+#include <cstddef>
 #include <cstdint>
-#include <functional>
-#include <istream>
-#include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "filter.hpp"
 
 namespace DB {
 
-class BloomFilter {
+// Blocked Bloom filter: a key maps to one 64-byte block (one cache line)
+// and sets numHashes bits inside it, so a lookup costs a single cache miss.
+// The high half of the key hash picks the block; each probe's bit position
+// comes from multiplying the low half by its own odd constant. On x86 CPUs
+// with AVX2 all probes are tested at once.
+class BloomFilter final : public KeyFilter {
 public:
-    BloomFilter(size_t size = 1 << 20, size_t hashes = 7);
+    static constexpr size_t kBlockBits = 512;
+    static constexpr size_t kMaxHashes = 8;
+    static constexpr size_t kHeaderSize = 8;
 
-    void add(const std::string &key);
-    bool possiblyContains(const std::string &key) const;
+    // Rounds `bits` up to whole blocks; `hashes` is clamped to [1, 8].
+    explicit BloomFilter(size_t bits = kBlockBits, size_t hashes = 7);
 
-    void serialize(std::ostream &os) const;
-    void deserialize(std::istream &is);
+    // A filter for `keys` keys at `bitsPerKey`, with the probe count that
+    // minimizes false positives for that density.
+    static BloomFilter forKeys(size_t keys, double bitsPerKey);
+    // Bits per key needed for a false-positive rate of about `fpr`.
+    static double bitsPerKeyForFpr(double fpr);
+    // round(bitsPerKey * ln 2), clamped to [1, 8].
+    static size_t optimalHashes(double bitsPerKey);
+
+    void add(std::string_view key) {
+        addHash(keyHash(key));
+    }
+
+    void addHash(uint64_t hash);
+
+    bool possiblyContainsHash(uint64_t hash) const override;
+    // The portable probe that possiblyContainsHash() falls back to without
+    // AVX2; both give the same answer for every hash.
+    bool possiblyContainsHashScalar(uint64_t hash) const;
+    // Whether possiblyContainsHash() uses AVX2 on this CPU.
+    static bool usesAvx2();
+
+    FilterType type() const override {
+        return FilterType::kBloom;
+    }
+
+    size_t memoryUsage() const override {
+        return blocks_.capacity() * sizeof(Block);
+    }
+
+    // Appends [numHashes:1][reserved:3][blocks:4] followed by every block
+    // as little-endian 64-bit words.
+    void encodeTo(std::string &out) const override;
+    // Loads a filter written by encodeTo(); false if `in` is malformed.
+    bool decodeFrom(std::string_view in);
 
 private:
-    size_t bitSize;
-    size_t numHashes;
-    std::vector<bool> bits;
+    struct alignas(64) Block {
+        uint64_t words[kBlockBits / 64];
+    };
+
+    std::vector<Block> blocks_;
+    size_t numHashes_;
 
-    uint64_t hash1(const std::string &key) const;
-    uint64_t hash2(const std::string &key) const;
-    uint64_t nthHash(uint64_t h1, uint64_t h2, size_t i) const;
+    size_t blockIndex(uint64_t hash) const {
+        // Multiply-shift maps the high half onto [0, blocks) without a
+        // division.
+        return ((hash >> 32) * blocks_.size()) >> 32;
+    }
 };
 
 }  // namespace DB
 
-#endif  // BLOOM_FILTER_HPP_
\ No newline at end of file
+#endif  // BLOOM_FILTER_HPP_
@@ -0,0 +1,105 @@
+#include "bloom.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+std::string member(size_t i) {
+    return "member:" + std::to_string(i);
+}
+
+std::string stranger(size_t i) {
+    return "stranger:" + std::to_string(i);
+}
+
+BloomFilter makeFilter(size_t keys, double bitsPerKey) {
+    auto filter = BloomFilter::forKeys(keys, bitsPerKey);
+    for (size_t i = 0; i < keys; ++i) {
+        filter.add(member(i));
+    }
+    return filter;
+}
+
+double falsePositiveRate(const KeyFilter &filter, size_t probes) {
+    size_t hits = 0;
+    for (size_t i = 0; i < probes; ++i) {
+        hits += filter.possiblyContains(stranger(i));
+    }
+    return static_cast<double>(hits) / probes;
+}
+
+}  // namespace
+
+TEST(BloomFilter, NoFalseNegatives) {
+    for (double bitsPerKey : {1.0, 4.0, 10.0, 20.0}) {
+        constexpr size_t kKeys = 20000;
+        auto filter = makeFilter(kKeys, bitsPerKey);
+        for (size_t i = 0; i < kKeys; ++i) {
+            ASSERT_TRUE(filter.possiblyContains(member(i)))
+                << bitsPerKey << " " << i;
+        }
+    }
+}
+
+TEST(BloomFilter, FalsePositiveRateAtTenBitsPerKey) {
+    auto filter = makeFilter(100000, 10);
+    // About 0.8% for a classic Bloom filter at this density; blocking costs
+    // a little on top.
+    double fpr = falsePositiveRate(filter, 200000);
+    EXPECT_LT(fpr, 0.015);
+    EXPECT_GT(fpr, 0.002);
+}
+
+TEST(BloomFilter, FalsePositivesFallWithDensity) {
+    double sparse = falsePositiveRate(makeFilter(50000, 6), 100000);
+    double dense = falsePositiveRate(makeFilter(50000, 16), 100000);
+    EXPECT_LT(dense, sparse / 10);
+}
+
+TEST(BloomFilter, EmptyFilterRejectsEverything) {
+    BloomFilter filter;
+    EXPECT_FALSE(filter.possiblyContains("anything"));
+    EXPECT_FALSE(filter.possiblyContains(""));
+}
+
+TEST(BloomFilter, OptimalHashes) {
+    EXPECT_EQ(BloomFilter::optimalHashes(1), 1u);
+    EXPECT_EQ(BloomFilter::optimalHashes(10), 7u);
+    EXPECT_EQ(BloomFilter::optimalHashes(100), BloomFilter::kMaxHashes);
+}
+
+TEST(BloomFilter, Avx2MatchesScalarProbe) {
+    // Sparse filters give a mix of hits and misses for every probe count.
+    for (size_t hashes = 1; hashes <= BloomFilter::kMaxHashes; ++hashes) {
+        BloomFilter filter(BloomFilter::kBlockBits * 64, hashes);
+        for (size_t i = 0; i < 2000; ++i) {
+            filter.add(member(i));
+        }
+        size_t hits = 0;
+        for (size_t i = 0; i < 20000; ++i) {
+            uint64_t hash = KeyFilter::keyHash(stranger(i));
+            bool scalar = filter.possiblyContainsHashScalar(hash);
+            ASSERT_EQ(filter.possiblyContainsHash(hash), scalar)
+                << hashes << " " << i;
+            hits += scalar;
+        }
+        EXPECT_GT(hits, 0u) << hashes;
+        EXPECT_LT(hits, 20000u) << hashes;
+    }
+    if (!BloomFilter::usesAvx2()) {
+        GTEST_SKIP() << "No AVX2 on this CPU; only the scalar probe ran";
+    }
+}
+
+TEST(BloomFilter, KeysAndPrefixesAreSeparate) {
+    BloomFilter filter(BloomFilter::kBlockBits * 16, 7);
+    filter.addHash(KeyFilter::prefixHash("tenant:1:"));
+    EXPECT_TRUE(filter.possiblyContainsPrefix("tenant:1:"));
+    EXPECT_FALSE(filter.possiblyContains("tenant:1:"));
+}
+
+}  // namespace DB
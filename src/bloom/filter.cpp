@@ -0,0 +1,47 @@
+#include "filter.hpp"
+#include "bloom.hpp"
+#include "xor_filter.hpp"
+
+namespace DB {
+
+std::unique_ptr<KeyFilter> buildFilter(
+    FilterType type,
+    std::vector<uint64_t> &hashes,
+    double bitsPerKey
+) {
+    if (type == FilterType::kXor8) {
+        auto filter = std::make_unique<XorFilter>();
+        if (filter->build(hashes)) {
+            return filter;
+        }
+    }
+    auto filter = std::make_unique<BloomFilter>(
+        BloomFilter::forKeys(hashes.size(), bitsPerKey)
+    );
+    for (uint64_t h : hashes) {
+        filter->addHash(h);
+    }
+    return filter;
+}
+
+std::unique_ptr<KeyFilter> decodeFilter(FilterType type, std::string_view in) {
+    switch (type) {
+        case FilterType::kBloom: {
+            auto filter = std::make_unique<BloomFilter>();
+            if (filter->decodeFrom(in)) {
+                return filter;
+            }
+            break;
+        }
+        case FilterType::kXor8: {
+            auto filter = std::make_unique<XorFilter>();
+            if (filter->decodeFrom(in)) {
+                return filter;
+            }
+            break;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace DB
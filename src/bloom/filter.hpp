@@ -0,0 +1,65 @@
+#ifndef KEY_FILTER_HPP_
+#define KEY_FILTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "filter_type.hpp"
+#include "hash.hpp"
+
+namespace DB {
+
+// Approximate membership test over the keys of one table: no false
+// negatives, a small rate of false positives. Every filter type works on the
+// same 64-bit key hash, so a table builder only keeps hashes.
+class KeyFilter {
+public:
+    virtual ~KeyFilter() = default;
+
+    static uint64_t keyHash(std::string_view key) {
+        return hash64(key);
+    }
+
+    // Prefixes share the filter with keys but use their own seed, so a
+    // prefix and a key with the same bytes are separate entries.
+    static uint64_t prefixHash(std::string_view prefix) {
+        return hash64(prefix, kPrefixSeed);
+    }
+
+    bool possiblyContains(std::string_view key) const {
+        return possiblyContainsHash(keyHash(key));
+    }
+
+    bool possiblyContainsPrefix(std::string_view prefix) const {
+        return possiblyContainsHash(prefixHash(prefix));
+    }
+
+    virtual bool possiblyContainsHash(uint64_t hash) const = 0;
+    virtual FilterType type() const = 0;
+    virtual size_t memoryUsage() const = 0;
+    // Appends the filter section; its layout depends on type().
+    virtual void encodeTo(std::string &out) const = 0;
+
+private:
+    static constexpr uint64_t kPrefixSeed = 0x9e3779b97f4a7c15ull;
+};
+
+// Builds a filter of `type` over `hashes`, which may be reordered.
+// `bitsPerKey` only applies to Bloom filters. Falls back to a Bloom filter if
+// the requested type cannot be built for these hashes.
+std::unique_ptr<KeyFilter> buildFilter(
+    FilterType type,
+    std::vector<uint64_t> &hashes,
+    double bitsPerKey
+);
+
+// Loads a section written by KeyFilter::encodeTo(); nullptr if the type is
+// unknown or the data malformed.
+std::unique_ptr<KeyFilter> decodeFilter(FilterType type, std::string_view in);
+
+}  // namespace DB
+
+#endif  // KEY_FILTER_HPP_
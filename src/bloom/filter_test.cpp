@@ -0,0 +1,148 @@
+#include "filter.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <userver/utest/utest.hpp>
+#include "bloom.hpp"
+
+namespace DB {
+
+namespace {
+
+std::vector<uint64_t> memberHashes(size_t keys) {
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < keys; ++i) {
+        hashes.push_back(KeyFilter::keyHash("member:" + std::to_string(i)));
+    }
+    return hashes;
+}
+
+double falsePositiveRate(const KeyFilter &filter, size_t probes) {
+    size_t hits = 0;
+    for (size_t i = 0; i < probes; ++i) {
+        hits += filter.possiblyContains("stranger:" + std::to_string(i));
+    }
+    return static_cast<double>(hits) / probes;
+}
+
+// Re-reads an encoded filter and checks it answers like the original.
+void expectRoundTrip(const KeyFilter &filter) {
+    std::string encoded;
+    filter.encodeTo(encoded);
+    auto decoded = decodeFilter(filter.type(), encoded);
+    ASSERT_NE(decoded, nullptr);
+    EXPECT_EQ(decoded->type(), filter.type());
+    for (size_t i = 0; i < 20000; ++i) {
+        uint64_t hash = KeyFilter::keyHash("probe:" + std::to_string(i));
+        ASSERT_EQ(
+            decoded->possiblyContainsHash(hash),
+            filter.possiblyContainsHash(hash)
+        ) << i;
+    }
+    std::string reencoded;
+    decoded->encodeTo(reencoded);
+    EXPECT_EQ(reencoded, encoded);
+}
+
+}  // namespace
+
+TEST(KeyFilter, BuildsRequestedType) {
+    for (auto type : {FilterType::kBloom, FilterType::kXor8}) {
+        auto hashes = memberHashes(1000);
+        auto filter = buildFilter(type, hashes, 10);
+        ASSERT_NE(filter, nullptr);
+        EXPECT_EQ(filter->type(), type);
+        for (uint64_t hash : memberHashes(1000)) {
+            ASSERT_TRUE(filter->possiblyContainsHash(hash));
+        }
+    }
+}
+
+TEST(KeyFilter, RoundTrip) {
+    for (auto type : {FilterType::kBloom, FilterType::kXor8}) {
+        for (size_t keys : {size_t{0}, size_t{1}, size_t{5000}}) {
+            auto hashes = memberHashes(keys);
+            expectRoundTrip(*buildFilter(type, hashes, 10));
+        }
+    }
+}
+
+TEST(KeyFilter, BloomEncodingIsLittleEndian) {
+    // One block with a single bit set, at bit 73 = word 1, bit 9.
+    std::string encoded = {1, 0, 0, 0, 1, 0, 0, 0};
+    encoded.append(64, '\0');
+    encoded[BloomFilter::kHeaderSize + 9] = 0x02;
+    auto filter = decodeFilter(FilterType::kBloom, encoded);
+    ASSERT_NE(filter, nullptr);
+
+    // With one probe, a hash hits exactly when its probe lands on that bit;
+    // the probe is the low half times the first salt, top 9 bits.
+    size_t hits = 0;
+    for (uint32_t h = 0; h < 100000; ++h) {
+        bool expected = (h * 0x47b6137bU) >> 23 == 73;
+        ASSERT_EQ(filter->possiblyContainsHash(h), expected) << h;
+        hits += expected;
+    }
+    EXPECT_GT(hits, 0u);
+
+    std::string reencoded;
+    filter->encodeTo(reencoded);
+    EXPECT_EQ(reencoded, encoded);
+}
+
+TEST(KeyFilter, BloomHeader) {
+    BloomFilter filter(BloomFilter::kBlockBits * 300, 5);
+    std::string encoded;
+    filter.encodeTo(encoded);
+    ASSERT_EQ(encoded.size(), BloomFilter::kHeaderSize + 300 * 64);
+    EXPECT_EQ(encoded[0], 5);
+    // Block count, little-endian: 300 = 0x012c.
+    EXPECT_EQ(static_cast<uint8_t>(encoded[4]), 0x2c);
+    EXPECT_EQ(static_cast<uint8_t>(encoded[5]), 0x01);
+    EXPECT_EQ(encoded[6], 0);
+    EXPECT_EQ(encoded[7], 0);
+}
+
+TEST(KeyFilter, RejectsMalformedSections) {
+    for (auto type : {FilterType::kBloom, FilterType::kXor8}) {
+        auto hashes = memberHashes(100);
+        std::string encoded;
+        buildFilter(type, hashes, 10)->encodeTo(encoded);
+        EXPECT_EQ(decodeFilter(type, {}), nullptr);
+        EXPECT_EQ(decodeFilter(type, encoded.substr(0, 4)), nullptr);
+        EXPECT_EQ(
+            decodeFilter(type, encoded.substr(0, encoded.size() - 1)), nullptr
+        );
+        EXPECT_EQ(decodeFilter(type, encoded + '\0'), nullptr);
+    }
+    // Probe counts outside [1, 8].
+    std::string bloom = {9, 0, 0, 0, 1, 0, 0, 0};
+    bloom.append(64, '\0');
+    EXPECT_EQ(decodeFilter(FilterType::kBloom, bloom), nullptr);
+    bloom[0] = 0;
+    EXPECT_EQ(decodeFilter(FilterType::kBloom, bloom), nullptr);
+    // Unknown filter type.
+    EXPECT_EQ(decodeFilter(static_cast<FilterType>(7), bloom), nullptr);
+}
+
+TEST(KeyFilter, BitsPerKeyForTargetFpr) {
+    constexpr size_t kKeys = 50000;
+    for (double target : {0.05, 0.01, 0.001}) {
+        double bitsPerKey = BloomFilter::bitsPerKeyForFpr(target);
+        auto hashes = memberHashes(kKeys);
+        auto filter = buildFilter(FilterType::kBloom, hashes, bitsPerKey);
+        double fpr = falsePositiveRate(*filter, 200000);
+        EXPECT_LT(fpr, target * 1.5) << target;
+        EXPECT_GT(fpr, target / 3) << target;
+    }
+}
+
+TEST(KeyFilter, MemoryFollowsBitsPerKey) {
+    auto hashes = memberHashes(10000);
+    auto small = buildFilter(FilterType::kBloom, hashes, 5);
+    auto large = buildFilter(FilterType::kBloom, hashes, 20);
+    EXPECT_NEAR(small->memoryUsage(), 10000 * 5 / 8, 64);
+    EXPECT_NEAR(large->memoryUsage(), 10000 * 20 / 8, 64);
+}
+
+}  // namespace DB
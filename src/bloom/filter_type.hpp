@@ -0,0 +1,22 @@
+#ifndef FILTER_TYPE_HPP_
+#define FILTER_TYPE_HPP_
+
+#include <cstdint>
+
+namespace DB {
+
+// Key filter of an SSTable. The value is stored in the table footer, so it
+// must never change for an existing filter.
+enum class FilterType : uint8_t {
+    // Blocked Bloom filter; density set by kFilterBitsPerKey or
+    // kFilterTargetFpr.
+    kBloom = 0,
+    // XOR filter with 8-bit fingerprints: 0.39% false positives at about
+    // 9.9 bits per key, roughly 25% smaller than a Bloom filter with the
+    // same rate. Slower to build.
+    kXor8 = 1,
+};
+
+}  // namespace DB
+
+#endif  // FILTER_TYPE_HPP_
@@ -0,0 +1,95 @@
+#ifndef BLOOM_HASH_HPP_
+#define BLOOM_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace DB {
+
+namespace detail {
+
+// Little-endian loads, so hashes (and the filters built from them) are the
+// same on every platform.
+inline uint64_t load64(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint64_t load32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+}  // namespace detail
+
+// wyhash (final version 4): a fast 64-bit hash of good quality that reads
+// the key in place, without allocating.
+inline uint64_t hash64(std::string_view key, uint64_t seed = 0) {
+    constexpr uint64_t s0 = 0x2d358dccaa6c78a5ull;
+    constexpr uint64_t s1 = 0x8bb84b93962eacc9ull;
+    constexpr uint64_t s2 = 0x4b33a62ed433d4a3ull;
+    constexpr uint64_t s3 = 0x4d5a2da51de1aa47ull;
+    using detail::load32;
+    using detail::load64;
+    using detail::mix;
+
+    const auto *p = reinterpret_cast<const uint8_t *>(key.data());
+    size_t len = key.size();
+    seed ^= mix(seed ^ s0, s1);
+    uint64_t a = 0, b = 0;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (load32(p) << 32) | load32(p + mid);
+            b = (load32(p + len - 4) << 32) | load32(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = (static_cast<uint64_t>(p[0]) << 16) |
+                (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(load64(p) ^ s1, load64(p + 8) ^ seed);
+                see1 = mix(load64(p + 16) ^ s2, load64(p + 24) ^ see1);
+                see2 = mix(load64(p + 32) ^ s3, load64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(load64(p) ^ s1, load64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = load64(p + i - 16);
+        b = load64(p + i - 8);
+    }
+    a ^= s1;
+    b ^= seed;
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+    return mix(a ^ s0 ^ len, b ^ s1);
+}
+
+}  // namespace DB
+
+#endif  // BLOOM_HASH_HPP_
@@ -0,0 +1,85 @@
+#ifndef PREFIX_EXTRACTOR_HPP_
+#define PREFIX_EXTRACTOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace DB {
+
+// Maps a key to the prefix that is added to its table's filter next to the
+// key itself, so a prefix scan can skip tables holding no key under that
+// prefix. Keys outside the extractor's domain (too short, too few
+// delimiters) contribute only their own hash.
+class PrefixExtractor {
+public:
+    static constexpr PrefixExtractor none() {
+        return PrefixExtractor(Kind::kNone, 0, 0);
+    }
+
+    // The first `length` bytes.
+    static constexpr PrefixExtractor fixed(uint16_t length) {
+        return PrefixExtractor(Kind::kFixed, 0, length);
+    }
+
+    // Everything up to and including the `count`-th `delimiter`, e.g.
+    // "tenant:42:" for delimited(':', 2).
+    static constexpr PrefixExtractor delimited(
+        char delimiter,
+        uint16_t count = 1
+    ) {
+        return PrefixExtractor(Kind::kDelimited, delimiter, count);
+    }
+
+    constexpr bool enabled() const {
+        return kind_ != Kind::kNone && param_ > 0;
+    }
+
+    std::optional<std::string_view> extract(std::string_view key) const {
+        if (!enabled()) {
+            return std::nullopt;
+        }
+        if (kind_ == Kind::kFixed) {
+            if (key.size() < param_) {
+                return std::nullopt;
+            }
+            return key.substr(0, param_);
+        }
+        size_t pos = 0;
+        for (uint16_t i = 0; i < param_; ++i, ++pos) {
+            pos = key.find(delimiter_, pos);
+            if (pos == std::string_view::npos) {
+                return std::nullopt;
+            }
+        }
+        return key.substr(0, pos);
+    }
+
+    // Stored in table footers: a table's filter only answers prefix
+    // queries for the extractor it was built with. 0 when disabled.
+    constexpr uint32_t id() const {
+        if (!enabled()) {
+            return 0;
+        }
+        return static_cast<uint32_t>(kind_) << 24 |
+               static_cast<uint32_t>(static_cast<uint8_t>(delimiter_)) << 16 |
+               param_;
+    }
+
+private:
+    enum class Kind : uint8_t { kNone = 0, kFixed = 1, kDelimited = 2 };
+
+    Kind kind_;
+    char delimiter_;
+    // Prefix length or delimiter count.
+    uint16_t param_;
+
+    constexpr PrefixExtractor(Kind kind, char delimiter, uint16_t param)
+        : kind_(kind), delimiter_(delimiter), param_(param) {
+    }
+};
+
+}  // namespace DB
+
+#endif  // PREFIX_EXTRACTOR_HPP_
@@ -0,0 +1,63 @@
+#include "prefix_extractor.hpp"
+#include <optional>
+#include <string_view>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+TEST(PrefixExtractor, FixedTakesLeadingBytes) {
+    auto extractor = PrefixExtractor::fixed(4);
+    EXPECT_TRUE(extractor.enabled());
+    EXPECT_EQ(extractor.extract("abcdefg"), std::string_view("abcd"));
+    EXPECT_EQ(extractor.extract("abcd"), std::string_view("abcd"));
+}
+
+TEST(PrefixExtractor, FixedSkipsShortKeys) {
+    auto extractor = PrefixExtractor::fixed(4);
+    EXPECT_EQ(extractor.extract("abc"), std::nullopt);
+    EXPECT_EQ(extractor.extract(""), std::nullopt);
+}
+
+TEST(PrefixExtractor, DelimitedKeepsTheDelimiter) {
+    auto extractor = PrefixExtractor::delimited(':');
+    EXPECT_EQ(extractor.extract("tenant:42:x"), std::string_view("tenant:"));
+    EXPECT_EQ(extractor.extract(":x"), std::string_view(":"));
+
+    auto twoLevels = PrefixExtractor::delimited(':', 2);
+    EXPECT_EQ(twoLevels.extract("tenant:42:x"), std::string_view("tenant:42:"));
+    EXPECT_EQ(twoLevels.extract("tenant:42:"), std::string_view("tenant:42:"));
+}
+
+TEST(PrefixExtractor, DelimitedSkipsKeysWithTooFewDelimiters) {
+    auto extractor = PrefixExtractor::delimited(':', 2);
+    EXPECT_EQ(extractor.extract("tenant:42"), std::nullopt);
+    EXPECT_EQ(extractor.extract("tenant"), std::nullopt);
+    EXPECT_EQ(extractor.extract(""), std::nullopt);
+}
+
+TEST(PrefixExtractor, DisabledExtractsNothing) {
+    for (auto extractor : {PrefixExtractor::none(), PrefixExtractor::fixed(0),
+                           PrefixExtractor::delimited(':', 0)}) {
+        EXPECT_FALSE(extractor.enabled());
+        EXPECT_EQ(extractor.extract("tenant:42:x"), std::nullopt);
+        EXPECT_EQ(extractor.id(), 0u);
+    }
+}
+
+TEST(PrefixExtractor, IdsTellExtractorsApart) {
+    auto fixed = PrefixExtractor::fixed(4);
+    auto longer = PrefixExtractor::fixed(5);
+    auto colon = PrefixExtractor::delimited(':');
+    auto slash = PrefixExtractor::delimited('/');
+    auto twoColons = PrefixExtractor::delimited(':', 2);
+    EXPECT_NE(fixed.id(), 0u);
+    EXPECT_NE(fixed.id(), longer.id());
+    EXPECT_NE(colon.id(), slash.id());
+    EXPECT_NE(colon.id(), twoColons.id());
+    EXPECT_EQ(colon.id(), PrefixExtractor::delimited(':', 1).id());
+    // A delimiter count and a prefix length with the same value differ.
+    EXPECT_NE(PrefixExtractor::fixed(1).id(),
+              PrefixExtractor::delimited('\0', 1).id());
+}
+
+}  // namespace DB
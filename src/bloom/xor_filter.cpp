@@ -0,0 +1,173 @@
+#include "xor_filter.hpp"
+#include <algorithm>
+
+namespace DB {
+
+namespace {
+
+constexpr int kMaxAttempts = 64;
+
+uint64_t mixSeed(uint64_t hash, uint64_t seed) {
+    uint64_t h = hash + seed;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t splitmix(uint64_t &state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+uint32_t reduce(uint32_t x, uint32_t n) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(x) * n) >> 32);
+}
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint8_t fingerprint(uint64_t h) {
+    return static_cast<uint8_t>(h ^ (h >> 32));
+}
+
+// The three slots of a mixed hash, one per third of the table.
+struct Slots {
+    uint32_t at[3];
+};
+
+Slots slotsFor(uint64_t h, uint32_t blockLength) {
+    return Slots{
+        {reduce(static_cast<uint32_t>(h), blockLength),
+         reduce(static_cast<uint32_t>(rotl(h, 21)), blockLength) +
+             blockLength,
+         reduce(static_cast<uint32_t>(rotl(h, 42)), blockLength) +
+             2 * blockLength}};
+}
+
+}  // namespace
+
+bool XorFilter::build(std::vector<uint64_t> &hashes) {
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    size_t size = hashes.size();
+    size_t capacity = 32 + static_cast<size_t>(1.23 * size);
+    blockLength_ = static_cast<uint32_t>(capacity / 3);
+    size_t slots = 3 * static_cast<size_t>(blockLength_);
+    fingerprints_.assign(slots, 0);
+
+    // Per slot: XOR of the mixed hashes that touch it and how many do.
+    std::vector<uint64_t> xorMask(slots);
+    std::vector<uint32_t> count(slots);
+    std::vector<uint32_t> queue;
+    // Peeled (hash, slot) pairs, in peeling order.
+    std::vector<std::pair<uint64_t, uint32_t>> stack;
+    queue.reserve(slots);
+    stack.reserve(size);
+
+    uint64_t rng = 0x726b2b9d438b9d4dull;
+    for (int attempt = 0; attempt < kMaxAttempts; ++attempt) {
+        seed_ = splitmix(rng);
+        std::fill(xorMask.begin(), xorMask.end(), 0);
+        std::fill(count.begin(), count.end(), 0);
+        for (uint64_t key : hashes) {
+            uint64_t h = mixSeed(key, seed_);
+            for (uint32_t slot : slotsFor(h, blockLength_).at) {
+                xorMask[slot] ^= h;
+                ++count[slot];
+            }
+        }
+        queue.clear();
+        for (uint32_t i = 0; i < slots; ++i) {
+            if (count[i] == 1) {
+                queue.push_back(i);
+            }
+        }
+        // A slot touched by a single key can be set last for that key;
+        // removing the key may leave other slots with a single key.
+        stack.clear();
+        while (!queue.empty()) {
+            uint32_t slot = queue.back();
+            queue.pop_back();
+            if (count[slot] != 1) {
+                continue;
+            }
+            uint64_t h = xorMask[slot];
+            stack.emplace_back(h, slot);
+            for (uint32_t other : slotsFor(h, blockLength_).at) {
+                xorMask[other] ^= h;
+                if (--count[other] == 1) {
+                    queue.push_back(other);
+                }
+            }
+        }
+        if (stack.size() == size) {
+            break;
+        }
+    }
+    if (stack.size() != size) {
+        return false;
+    }
+
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        auto s = slotsFor(it->first, blockLength_);
+        fingerprints_[it->second] =
+            fingerprint(it->first) ^ fingerprints_[s.at[0]] ^
+            fingerprints_[s.at[1]] ^ fingerprints_[s.at[2]];
+    }
+    return true;
+}
+
+bool XorFilter::possiblyContainsHash(uint64_t hash) const {
+    if (fingerprints_.empty()) {
+        return false;
+    }
+    uint64_t h = mixSeed(hash, seed_);
+    auto s = slotsFor(h, blockLength_);
+    return fingerprint(h) == (fingerprints_[s.at[0]] ^
+                              fingerprints_[s.at[1]] ^
+                              fingerprints_[s.at[2]]);
+}
+
+void XorFilter::encodeTo(std::string &out) const {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>(seed_ >> (8 * i)));
+    }
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>(blockLength_ >> (8 * i)));
+    }
+    out.append(
+        reinterpret_cast<const char *>(fingerprints_.data()),
+        fingerprints_.size()
+    );
+}
+
+bool XorFilter::decodeFrom(std::string_view in) {
+    if (in.size() < kHeaderSize) {
+        return false;
+    }
+    const auto *p = reinterpret_cast<const uint8_t *>(in.data());
+    uint64_t seed = 0;
+    uint32_t blockLength = 0;
+    for (int i = 0; i < 8; ++i) {
+        seed |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    for (int i = 0; i < 4; ++i) {
+        blockLength |= static_cast<uint32_t>(p[8 + i]) << (8 * i);
+    }
+    if (blockLength == 0 ||
+        in.size() - kHeaderSize != 3 * static_cast<size_t>(blockLength)) {
+        return false;
+    }
+    seed_ = seed;
+    blockLength_ = blockLength;
+    fingerprints_.assign(p + kHeaderSize, p + in.size());
+    return true;
+}
+
+}  // namespace DB
@@ -0,0 +1,52 @@
+#ifndef XOR_FILTER_HPP_
+#define XOR_FILTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "filter.hpp"
+
+namespace DB {
+
+// XOR filter with 8-bit fingerprints (Graf and Lemire, "Xor Filters: Faster
+// and Smaller Than Bloom and Cuckoo Filters"). A key is present if the XOR
+// of three fingerprint slots, one in each third of the table, equals its
+// fingerprint. About 1.23 slots per key give 0.39% false positives.
+//
+// Static: it is built once from all key hashes by peeling a 3-hypergraph,
+// which occasionally needs another seed.
+class XorFilter final : public KeyFilter {
+public:
+    static constexpr size_t kHeaderSize = 12;
+
+    XorFilter() = default;
+
+    // Fails only if no seed peels, which practically means duplicate hashes
+    // (they are removed first, so it should not happen).
+    bool build(std::vector<uint64_t> &hashes);
+
+    bool possiblyContainsHash(uint64_t hash) const override;
+
+    FilterType type() const override {
+        return FilterType::kXor8;
+    }
+
+    size_t memoryUsage() const override {
+        return fingerprints_.capacity();
+    }
+
+    // [seed:8][blockLength:4] followed by 3 * blockLength fingerprints.
+    void encodeTo(std::string &out) const override;
+    bool decodeFrom(std::string_view in);
+
+private:
+    uint64_t seed_ = 0;
+    uint32_t blockLength_ = 0;
+    std::vector<uint8_t> fingerprints_;
+};
+
+}  // namespace DB
+
+#endif  // XOR_FILTER_HPP_
@@ -0,0 +1,134 @@
+#include "xor_filter.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <userver/utest/utest.hpp>
+#include "bloom.hpp"
+
+namespace DB {
+
+namespace {
+
+std::vector<uint64_t> memberHashes(size_t keys) {
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < keys; ++i) {
+        hashes.push_back(KeyFilter::keyHash("member:" + std::to_string(i)));
+    }
+    return hashes;
+}
+
+XorFilter makeFilter(size_t keys) {
+    XorFilter filter;
+    auto hashes = memberHashes(keys);
+    EXPECT_TRUE(filter.build(hashes));
+    return filter;
+}
+
+}  // namespace
+
+TEST(XorFilter, NoFalseNegatives) {
+    for (size_t keys : {size_t{1}, size_t{10}, size_t{1000}, size_t{100000}}) {
+        auto filter = makeFilter(keys);
+        for (uint64_t hash : memberHashes(keys)) {
+            ASSERT_TRUE(filter.possiblyContainsHash(hash)) << keys;
+        }
+    }
+}
+
+TEST(XorFilter, FalsePositiveRate) {
+    auto filter = makeFilter(100000);
+    size_t hits = 0;
+    constexpr size_t kProbes = 500000;
+    for (size_t i = 0; i < kProbes; ++i) {
+        hits += filter.possiblyContains("stranger:" + std::to_string(i));
+    }
+    // 1/256 for 8-bit fingerprints.
+    double fpr = static_cast<double>(hits) / kProbes;
+    EXPECT_LT(fpr, 0.006);
+    EXPECT_GT(fpr, 0.002);
+}
+
+TEST(XorFilter, SmallerThanBloomAtSimilarFpr) {
+    auto filter = makeFilter(100000);
+    auto bloom = BloomFilter::forKeys(
+        100000, BloomFilter::bitsPerKeyForFpr(1.0 / 256)
+    );
+    // About 1.23 bytes per key.
+    EXPECT_LT(filter.memoryUsage(), 100000 * 1.25 + 64);
+    EXPECT_LT(filter.memoryUsage(), bloom.memoryUsage());
+}
+
+TEST(XorFilter, IgnoresDuplicateHashes) {
+    auto hashes = memberHashes(1000);
+    auto doubled = hashes;
+    doubled.insert(doubled.end(), hashes.begin(), hashes.end());
+    XorFilter filter;
+    ASSERT_TRUE(filter.build(doubled));
+    for (uint64_t hash : hashes) {
+        ASSERT_TRUE(filter.possiblyContainsHash(hash));
+    }
+}
+
+TEST(XorFilter, EmptyFilter) {
+    std::vector<uint64_t> none;
+    XorFilter built;
+    ASSERT_TRUE(built.build(none));
+    EXPECT_FALSE(built.possiblyContains("anything"));
+    // Never built or decoded.
+    EXPECT_FALSE(XorFilter().possiblyContains("anything"));
+}
+
+TEST(XorFilter, EncodeDecodeRoundTrip) {
+    auto filter = makeFilter(5000);
+    std::string encoded;
+    filter.encodeTo(encoded);
+    ASSERT_EQ(
+        encoded.size(), XorFilter::kHeaderSize + filter.memoryUsage()
+    );
+
+    XorFilter decoded;
+    ASSERT_TRUE(decoded.decodeFrom(encoded));
+    for (uint64_t hash : memberHashes(5000)) {
+        ASSERT_TRUE(decoded.possiblyContainsHash(hash));
+    }
+    for (size_t i = 0; i < 20000; ++i) {
+        uint64_t hash = KeyFilter::keyHash("probe:" + std::to_string(i));
+        ASSERT_EQ(
+            decoded.possiblyContainsHash(hash),
+            filter.possiblyContainsHash(hash)
+        );
+    }
+    std::string reencoded;
+    decoded.encodeTo(reencoded);
+    EXPECT_EQ(reencoded, encoded);
+}
+
+TEST(XorFilter, HeaderIsLittleEndian) {
+    auto filter = makeFilter(1000);
+    std::string encoded;
+    filter.encodeTo(encoded);
+    const auto *p = reinterpret_cast<const uint8_t *>(encoded.data());
+    uint32_t blockLength = 0;
+    for (int i = 0; i < 4; ++i) {
+        blockLength |= static_cast<uint32_t>(p[8 + i]) << (8 * i);
+    }
+    EXPECT_EQ(
+        encoded.size(),
+        XorFilter::kHeaderSize + 3 * static_cast<size_t>(blockLength)
+    );
+}
+
+TEST(XorFilter, RejectsMalformedInput) {
+    auto filter = makeFilter(100);
+    std::string encoded;
+    filter.encodeTo(encoded);
+    XorFilter decoded;
+    EXPECT_FALSE(decoded.decodeFrom(encoded.substr(0, 11)));
+    EXPECT_FALSE(decoded.decodeFrom(encoded.substr(0, encoded.size() - 1)));
+    EXPECT_FALSE(decoded.decodeFrom(encoded + '\0'));
+    // A zero block length.
+    std::string empty(XorFilter::kHeaderSize, '\0');
+    EXPECT_FALSE(decoded.decodeFrom(empty));
+}
+
+}  // namespace DB
@@ -0,0 +1,157 @@
+#include "block_cache.hpp"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace DB {
+
+BlockCache::Handle::Handle(Handle &&other) noexcept
+    : cache_(std::exchange(other.cache_, nullptr)),
+      fileId_(other.fileId_),
+      offset_(other.offset_) {
+}
+
+BlockCache::Handle &BlockCache::Handle::operator=(Handle &&other) noexcept {
+    if (this != &other) {
+        if (cache_) {
+            cache_->unpin(fileId_, offset_);
+        }
+        cache_ = std::exchange(other.cache_, nullptr);
+        fileId_ = other.fileId_;
+        offset_ = other.offset_;
+    }
+    return *this;
+}
+
+BlockCache::Handle::~Handle() {
+    if (cache_) {
+        cache_->unpin(fileId_, offset_);
+    }
+}
+
+BlockCache::BlockCache(size_t capacityBytes, size_t shardCount)
+    : shardCapacity_(capacityBytes / std::max<size_t>(shardCount, 1)),
+      shards_(std::max<size_t>(shardCount, 1)) {
+}
+
+BlockCache::Block BlockCache::lookup(uint64_t fileId, uint64_t offset) {
+    Key key{fileId, offset};
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    if (found == shard.map.end() || !found->second->block) {
+        ++shard.misses;
+        return nullptr;
+    }
+    ++shard.hits;
+    auto it = found->second;
+    if (it->pins == 0) {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    }
+    return it->block;
+}
+
+void BlockCache::insert(uint64_t fileId, uint64_t offset, Block block) {
+    if (!block) {
+        return;
+    }
+    Key key{fileId, offset};
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    if (found != shard.map.end()) {
+        if (found->second->pins > 0) {
+            return;
+        }
+        eraseLocked(shard, found->second);
+    }
+    size_t charge = block->size();
+    shard.lru.push_front(Entry{key, std::move(block), charge, 0});
+    shard.map.emplace(key, shard.lru.begin());
+    shard.usage += charge;
+    evictLocked(shard);
+}
+
+BlockCache::Handle BlockCache::pin(
+    uint64_t fileId,
+    uint64_t offset,
+    Block block,
+    size_t charge
+) {
+    Key key{fileId, offset};
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    if (found != shard.map.end()) {
+        auto it = found->second;
+        if (it->pins++ == 0) {
+            shard.pinned.splice(shard.pinned.begin(), shard.lru, it);
+            shard.pinnedUsage += it->charge;
+        }
+    } else {
+        shard.pinned.push_front(Entry{key, std::move(block), charge, 1});
+        shard.map.emplace(key, shard.pinned.begin());
+        shard.usage += charge;
+        shard.pinnedUsage += charge;
+        evictLocked(shard);
+    }
+    return Handle(this, fileId, offset);
+}
+
+void BlockCache::unpin(uint64_t fileId, uint64_t offset) {
+    Key key{fileId, offset};
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    if (found == shard.map.end()) {
+        return;
+    }
+    auto it = found->second;
+    if (--it->pins > 0) {
+        return;
+    }
+    shard.pinnedUsage -= it->charge;
+    if (!it->block) {
+        // Memory owned by the caller, who is releasing it.
+        shard.usage -= it->charge;
+        shard.map.erase(found);
+        shard.pinned.erase(it);
+        return;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.pinned, it);
+    evictLocked(shard);
+}
+
+BlockCache::Stats BlockCache::stats() const {
+    Stats total;
+    total.capacity = shardCapacity_ * shards_.size();
+    for (const auto &shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total.hits += shard.hits;
+        total.misses += shard.misses;
+        total.evictions += shard.evictions;
+        total.usage += shard.usage;
+        total.pinnedUsage += shard.pinnedUsage;
+    }
+    return total;
+}
+
+void BlockCache::eraseLocked(Shard &shard, std::list<Entry>::iterator it) {
+    shard.usage -= it->charge;
+    shard.map.erase(it->key);
+    if (it->pins > 0) {
+        shard.pinnedUsage -= it->charge;
+        shard.pinned.erase(it);
+    } else {
+        shard.lru.erase(it);
+    }
+}
+
+void BlockCache::evictLocked(Shard &shard) {
+    while (shard.usage > shardCapacity_ && !shard.lru.empty()) {
+        eraseLocked(shard, std::prev(shard.lru.end()));
+        ++shard.evictions;
+    }
+}
+
+}  // namespace DB
@@ -0,0 +1,135 @@
+#ifndef BLOCK_CACHE_HPP_
+#define BLOCK_CACHE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DB {
+
+// Byte-bounded LRU cache of SSTable blocks, split into independently locked
+// shards. Entries are keyed by (file id, block offset); file ids come from
+// newFileId() and are never reused, so blocks of a deleted table simply age
+// out.
+//
+// Blocks are shared_ptrs: a reader keeps using a block after it has been
+// evicted. Pinned entries are never evicted; tables pin their index and
+// filter so that metadata memory is charged against the same budget.
+class BlockCache {
+public:
+    using Block = std::shared_ptr<const std::string>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t usage = 0;
+        size_t pinnedUsage = 0;
+        size_t capacity = 0;
+    };
+
+    // Keeps an entry pinned until destroyed.
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(Handle &&other) noexcept;
+        Handle &operator=(Handle &&other) noexcept;
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+        ~Handle();
+
+    private:
+        friend class BlockCache;
+        Handle(BlockCache *cache, uint64_t fileId, uint64_t offset)
+            : cache_(cache), fileId_(fileId), offset_(offset) {
+        }
+
+        BlockCache *cache_ = nullptr;
+        uint64_t fileId_ = 0;
+        uint64_t offset_ = 0;
+    };
+
+    explicit BlockCache(size_t capacityBytes, size_t shardCount = 16);
+    BlockCache(const BlockCache &) = delete;
+    BlockCache &operator=(const BlockCache &) = delete;
+
+    uint64_t newFileId() {
+        return nextFileId_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // nullptr on a miss.
+    Block lookup(uint64_t fileId, uint64_t offset);
+    // Caches `block`, charged at its size. Replaces an unpinned entry with
+    // the same key.
+    void insert(uint64_t fileId, uint64_t offset, Block block);
+    // Caches `block` (which may be null when the memory is owned elsewhere)
+    // with an explicit charge and pins it until the handle is destroyed. The
+    // cache must outlive the handle.
+    Handle pin(uint64_t fileId, uint64_t offset, Block block, size_t charge);
+
+    Stats stats() const;
+
+private:
+    struct Key {
+        uint64_t fileId;
+        uint64_t offset;
+
+        bool operator==(const Key &o) const {
+            return fileId == o.fileId && offset == o.offset;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &k) const {
+            // Multiplying only carries bits upwards, so the high half is
+            // folded back in; otherwise aligned offsets, which share their
+            // low bits, would all pick the same shard.
+            uint64_t h = k.fileId * 0x9e3779b97f4a7c15ull ^
+                         k.offset * 0xc2b2ae3d27d4eb4full;
+            return static_cast<size_t>(h ^ (h >> 32));
+        }
+    };
+
+    struct Entry {
+        Key key;
+        Block block;
+        size_t charge;
+        size_t pins;
+    };
+
+    // Unpinned entries are in `lru`, most recently used first; pinned ones
+    // are in `pinned` so eviction never has to skip them.
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;
+        std::list<Entry> pinned;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> map;
+        size_t usage = 0;
+        size_t pinnedUsage = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    size_t shardCapacity_;
+    std::vector<Shard> shards_;
+    std::atomic<uint64_t> nextFileId_{1};
+
+    Shard &shardFor(const Key &key) {
+        return shards_[KeyHash{}(key) % shards_.size()];
+    }
+
+    void unpin(uint64_t fileId, uint64_t offset);
+    void eraseLocked(Shard &shard, std::list<Entry>::iterator it);
+    void evictLocked(Shard &shard);
+};
+
+}  // namespace DB
+
+#endif  // BLOCK_CACHE_HPP_
@@ -0,0 +1,161 @@
+#include "block_cache.hpp"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+BlockCache::Block makeBlock(size_t size, char fill = 'x') {
+    return std::make_shared<const std::string>(size, fill);
+}
+
+}  // namespace
+
+TEST(BlockCache, LookupHitsAndMisses) {
+    BlockCache cache(1000, 1);
+    EXPECT_EQ(cache.lookup(1, 0), nullptr);
+    auto block = makeBlock(100);
+    cache.insert(1, 0, block);
+    EXPECT_EQ(cache.lookup(1, 0), block);
+    EXPECT_EQ(cache.lookup(1, 100), nullptr);
+    EXPECT_EQ(cache.lookup(2, 0), nullptr);
+
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.usage, 100u);
+    EXPECT_EQ(stats.capacity, 1000u);
+}
+
+TEST(BlockCache, EvictsLeastRecentlyUsed) {
+    BlockCache cache(300, 1);
+    cache.insert(1, 0, makeBlock(100));
+    cache.insert(1, 1, makeBlock(100));
+    cache.insert(1, 2, makeBlock(100));
+    // Touching the oldest block makes the second one the next victim.
+    ASSERT_NE(cache.lookup(1, 0), nullptr);
+    cache.insert(1, 3, makeBlock(100));
+
+    EXPECT_NE(cache.lookup(1, 0), nullptr);
+    EXPECT_EQ(cache.lookup(1, 1), nullptr);
+    EXPECT_NE(cache.lookup(1, 2), nullptr);
+    EXPECT_NE(cache.lookup(1, 3), nullptr);
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.usage, 300u);
+}
+
+TEST(BlockCache, EvictedBlockStaysUsableByReader) {
+    BlockCache cache(100, 1);
+    cache.insert(1, 0, makeBlock(100, 'a'));
+    auto held = cache.lookup(1, 0);
+    cache.insert(1, 1, makeBlock(100, 'b'));
+    EXPECT_EQ(cache.lookup(1, 0), nullptr);
+    ASSERT_NE(held, nullptr);
+    EXPECT_EQ(*held, std::string(100, 'a'));
+}
+
+TEST(BlockCache, ReinsertReplacesAndRecharges) {
+    BlockCache cache(1000, 1);
+    cache.insert(1, 0, makeBlock(100, 'a'));
+    cache.insert(1, 0, makeBlock(300, 'b'));
+    EXPECT_EQ(*cache.lookup(1, 0), std::string(300, 'b'));
+    EXPECT_EQ(cache.stats().usage, 300u);
+}
+
+TEST(BlockCache, PinnedEntriesAreNeverEvicted) {
+    BlockCache cache(300, 1);
+    {
+        // Metadata owned elsewhere: no block, only a charge.
+        auto handle = cache.pin(1, UINT64_MAX, nullptr, 200);
+        cache.insert(2, 0, makeBlock(100));
+        cache.insert(2, 1, makeBlock(100));
+        auto stats = cache.stats();
+        EXPECT_EQ(stats.pinnedUsage, 200u);
+        EXPECT_EQ(stats.usage, 300u);
+        EXPECT_EQ(stats.evictions, 1u);
+        EXPECT_EQ(cache.lookup(2, 0), nullptr);
+        EXPECT_NE(cache.lookup(2, 1), nullptr);
+        // A charge-only entry is not a cached block.
+        EXPECT_EQ(cache.lookup(1, UINT64_MAX), nullptr);
+    }
+    // Releasing the pin returns its charge.
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.pinnedUsage, 0u);
+    EXPECT_EQ(stats.usage, 100u);
+}
+
+TEST(BlockCache, PinningCachedBlockProtectsItUntilReleased) {
+    BlockCache cache(200, 1);
+    auto block = makeBlock(100);
+    cache.insert(1, 0, block);
+    auto handle = cache.pin(1, 0, nullptr, 0);
+    // Pinning twice needs two releases.
+    auto second = cache.pin(1, 0, nullptr, 0);
+    cache.insert(1, 1, makeBlock(100));
+    cache.insert(1, 2, makeBlock(100));
+    EXPECT_EQ(cache.lookup(1, 0), block);
+    EXPECT_EQ(cache.stats().pinnedUsage, 100u);
+
+    handle = BlockCache::Handle();
+    EXPECT_EQ(cache.stats().pinnedUsage, 100u);
+    second = BlockCache::Handle();
+    EXPECT_EQ(cache.stats().pinnedUsage, 0u);
+    // Back in the LRU list as its most recent entry.
+    cache.insert(1, 3, makeBlock(100));
+    EXPECT_EQ(cache.lookup(1, 0), block);
+    EXPECT_EQ(cache.stats().usage, 200u);
+}
+
+TEST(BlockCache, InsertDoesNotReplacePinnedEntry) {
+    BlockCache cache(1000, 1);
+    auto block = makeBlock(100, 'a');
+    auto handle = cache.pin(1, 0, block, block->size());
+    cache.insert(1, 0, makeBlock(100, 'b'));
+    EXPECT_EQ(cache.lookup(1, 0), block);
+}
+
+TEST(BlockCache, ShardsSplitCapacity) {
+    constexpr size_t kShards = 4;
+    BlockCache cache(kShards * 1000, kShards);
+    EXPECT_EQ(cache.stats().capacity, kShards * 1000);
+    for (uint64_t offset = 0; offset < 400; ++offset) {
+        cache.insert(1, offset * 100, makeBlock(100));
+    }
+    // Each shard is bounded on its own, so the total never exceeds the
+    // capacity even though keys do not spread perfectly evenly.
+    auto stats = cache.stats();
+    EXPECT_LE(stats.usage, stats.capacity);
+    EXPECT_EQ(stats.usage + stats.evictions * 100, 400u * 100);
+    // Keys land in more than one shard: a single shard holds at most 10.
+    EXPECT_GT(stats.usage, 1000u);
+}
+
+TEST(BlockCache, ConcurrentAccessKeepsCountsConsistent) {
+    BlockCache cache(64 * 1024, 8);
+    constexpr int kThreads = 4;
+    constexpr int kOps = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < kOps; ++i) {
+                uint64_t offset = static_cast<uint64_t>((i * 7 + t) % 1000);
+                if (!cache.lookup(1, offset)) {
+                    cache.insert(1, offset, makeBlock(128));
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.hits + stats.misses, uint64_t{kThreads} * kOps);
+    EXPECT_LE(stats.usage, stats.capacity);
+}
+
+}  // namespace DB
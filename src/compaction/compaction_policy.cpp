@@ -0,0 +1,303 @@
+#include "compaction_policy.hpp"
+#include <algorithm>
+
+namespace DB {
+
+namespace {
+
+uint64_t totalBytes(const std::vector<std::shared_ptr<SSTable>> &tables) {
+    uint64_t bytes = 0;
+    for (const auto &t : tables)
+        bytes += t->fileSize();
+    return bytes;
+}
+
+bool overlaps(
+    const SSTable &table,
+    std::string_view smallest,
+    std::string_view largest
+) {
+    return !table.empty() && table.largestKey() >= smallest &&
+           table.smallestKey() <= largest;
+}
+
+// Key range covered by `tables`; false if they are all empty.
+bool keyRange(
+    const std::vector<std::shared_ptr<SSTable>> &tables,
+    std::string &smallest,
+    std::string &largest
+) {
+    bool any = false;
+    for (const auto &t : tables) {
+        if (t->empty())
+            continue;
+        if (!any || t->smallestKey() < smallest)
+            smallest = std::string(t->smallestKey());
+        if (!any || t->largestKey() > largest)
+            largest = std::string(t->largestKey());
+        any = true;
+    }
+    return any;
+}
+
+void removeInputs(
+    std::vector<std::shared_ptr<SSTable>> &tables,
+    const std::vector<std::shared_ptr<SSTable>> &inputs
+) {
+    tables.erase(
+        std::remove_if(
+            tables.begin(), tables.end(),
+            [&inputs](const std::shared_ptr<SSTable> &t) {
+                return std::find(inputs.begin(), inputs.end(), t) !=
+                       inputs.end();
+            }
+        ),
+        tables.end()
+    );
+}
+
+}  // namespace
+
+LeveledCompactionPolicy::LeveledCompactionPolicy(
+    size_t l0CompactionTrigger,
+    uint64_t level1MaxBytes,
+    double levelSizeMultiplier,
+    uint64_t targetFileBytes
+)
+    : l0CompactionTrigger_(l0CompactionTrigger),
+      level1MaxBytes_(level1MaxBytes),
+      levelSizeMultiplier_(levelSizeMultiplier),
+      targetFileBytes_(targetFileBytes) {
+}
+
+uint64_t LeveledCompactionPolicy::maxBytesForLevel(int level) const {
+    double bytes = static_cast<double>(level1MaxBytes_);
+    for (int l = 1; l < level; ++l)
+        bytes *= levelSizeMultiplier_;
+    return static_cast<uint64_t>(bytes);
+}
+
+std::optional<CompactionJob> LeveledCompactionPolicy::pick(
+    const LevelTables &levels
+) {
+    int numLevels = static_cast<int>(levels.size());
+    if (numLevels < 2)
+        return std::nullopt;
+    compactPointer_.resize(levels.size());
+
+    // L0 is scored by table count since every table there is consulted on
+    // a miss; deeper levels by size against their budget. The last level
+    // has nowhere to go.
+    int best = -1;
+    double bestScore = 1;
+    for (int level = 0; level + 1 < numLevels; ++level) {
+        double score =
+            level == 0
+                ? static_cast<double>(levels[0].size()) /
+                      l0CompactionTrigger_
+                : static_cast<double>(totalBytes(levels[level])) /
+                      maxBytesForLevel(level);
+        if (score >= bestScore) {
+            best = level;
+            bestScore = score;
+        }
+    }
+    if (best < 0)
+        return std::nullopt;
+
+    CompactionJob job;
+    job.level = best;
+    job.outputLevel = best + 1;
+    job.score = bestScore;
+    job.targetFileBytes = targetFileBytes_;
+    if (best == 0) {
+        // L0 tables overlap each other, so they all go together.
+        job.inputs.assign(levels[0].rbegin(), levels[0].rend());
+    } else {
+        const auto &tables = levels[best];
+        const auto &pointer = compactPointer_[best];
+        auto it = std::find_if(
+            tables.begin(), tables.end(),
+            [&pointer](const std::shared_ptr<SSTable> &t) {
+                return t->smallestKey() > pointer;
+            }
+        );
+        if (it == tables.end())
+            it = tables.begin();
+        job.inputs.push_back(*it);
+        compactPointer_[best] = std::string((*it)->largestKey());
+    }
+
+    std::string smallest, largest;
+    if (!keyRange(job.inputs, smallest, largest)) {
+        // Only empty tables; rewriting them just drops them.
+        job.dropTombstones = true;
+        return job;
+    }
+    size_t fromLevel = job.inputs.size();
+    for (const auto &t : levels[job.outputLevel]) {
+        if (overlaps(*t, smallest, largest))
+            job.inputs.push_back(t);
+    }
+    if (best > 0 && job.inputs.size() == fromLevel) {
+        job.trivialMove = true;
+        return job;
+    }
+    keyRange(job.inputs, smallest, largest);
+    job.dropTombstones = true;
+    for (int level = job.outputLevel + 1; level < numLevels; ++level) {
+        for (const auto &t : levels[level]) {
+            if (overlaps(*t, smallest, largest))
+                job.dropTombstones = false;
+        }
+    }
+    return job;
+}
+
+void LeveledCompactionPolicy::install(
+    LevelTables &levels,
+    const CompactionJob &job,
+    std::vector<std::shared_ptr<SSTable>> outputs
+) const {
+    removeInputs(levels[job.level], job.inputs);
+    removeInputs(levels[job.outputLevel], job.inputs);
+    auto &target = levels[job.outputLevel];
+    for (auto &t : outputs) {
+        if (!t->empty())
+            target.push_back(std::move(t));
+    }
+    std::sort(
+        target.begin(), target.end(),
+        [](const std::shared_ptr<SSTable> &a,
+           const std::shared_ptr<SSTable> &b) {
+            return a->smallestKey() < b->smallestKey();
+        }
+    );
+}
+
+SizeTieredCompactionPolicy::SizeTieredCompactionPolicy(
+    size_t minMergeWidth,
+    double sizeRatio,
+    size_t maxRuns
+)
+    : minMergeWidth_(minMergeWidth), sizeRatio_(sizeRatio), maxRuns_(maxRuns) {
+}
+
+std::optional<CompactionJob> SizeTieredCompactionPolicy::pick(
+    const LevelTables &levels
+) {
+    if (levels.empty())
+        return std::nullopt;
+    const auto &runs = levels[0];
+    const size_t minWidth = minMergeWidth_;
+
+    // Runs must stay ordered by age for newest-wins lookups, so only
+    // neighbours are merged: the widest window whose sizes all stay within
+    // sizeRatio_ of the window's average.
+    size_t bestBegin = 0, bestWidth = 0;
+    for (size_t begin = 0; begin < runs.size(); ++begin) {
+        uint64_t sum = 0;
+        size_t end = begin;
+        while (end < runs.size()) {
+            double avg = static_cast<double>(sum + runs[end]->fileSize()) /
+                         (end - begin + 1);
+            bool similar = true;
+            for (size_t i = begin; i <= end && similar; ++i) {
+                double s = static_cast<double>(runs[i]->fileSize());
+                similar = s <= avg * sizeRatio_ && s * sizeRatio_ >= avg;
+            }
+            if (!similar)
+                break;
+            sum += runs[end]->fileSize();
+            ++end;
+        }
+        if (end - begin > bestWidth) {
+            bestBegin = begin;
+            bestWidth = end - begin;
+        }
+    }
+
+    CompactionJob job;
+    if (bestWidth >= minWidth) {
+        job.score = static_cast<double>(bestWidth) / minWidth;
+    } else if (runs.size() > maxRuns_) {
+        // No similar-sized neighbours, but too many runs for reads: merge
+        // the cheapest adjacent window.
+        uint64_t cheapest = UINT64_MAX;
+        for (size_t begin = 0; begin + minWidth <= runs.size(); ++begin) {
+            uint64_t bytes = 0;
+            for (size_t i = begin; i < begin + minWidth; ++i)
+                bytes += runs[i]->fileSize();
+            if (bytes < cheapest) {
+                cheapest = bytes;
+                bestBegin = begin;
+            }
+        }
+        bestWidth = minWidth;
+        job.score = static_cast<double>(runs.size()) / maxRuns_;
+    } else {
+        return std::nullopt;
+    }
+    for (size_t i = bestBegin + bestWidth; i-- > bestBegin;)
+        job.inputs.push_back(runs[i]);
+    // The oldest run has nothing behind it for a tombstone to hide.
+    job.dropTombstones = bestBegin == 0;
+    return job;
+}
+
+void SizeTieredCompactionPolicy::install(
+    LevelTables &levels,
+    const CompactionJob &job,
+    std::vector<std::shared_ptr<SSTable>> outputs
+) const {
+    // Newer runs flushed meanwhile were appended after the window, so the
+    // merged run takes the window's place.
+    auto &runs = levels[0];
+    auto first = std::find_if(
+        runs.begin(), runs.end(),
+        [&job](const std::shared_ptr<SSTable> &t) {
+            return std::find(job.inputs.begin(), job.inputs.end(), t) !=
+                   job.inputs.end();
+        }
+    );
+    size_t pos = first - runs.begin();
+    removeInputs(runs, job.inputs);
+    outputs.erase(
+        std::remove_if(
+            outputs.begin(), outputs.end(),
+            [](const std::shared_ptr<SSTable> &t) { return t->empty(); }
+        ),
+        outputs.end()
+    );
+    runs.insert(runs.begin() + pos, outputs.begin(), outputs.end());
+}
+
+std::unique_ptr<CompactionPolicy> makeCompactionPolicy(CompactionStyle style) {
+    if (style == CompactionStyle::kSizeTiered)
+        return std::make_unique<SizeTieredCompactionPolicy>();
+    return std::make_unique<LeveledCompactionPolicy>();
+}
+
+std::vector<std::string> subcompactionSplits(
+    const CompactionJob &job,
+    size_t parts
+) {
+    std::vector<std::string_view> candidates;
+    for (const auto &t : job.inputs) {
+        const auto &index = t->GetIndex();
+        for (size_t i = 0; i < index.size(); ++i)
+            candidates.push_back(index.lastKey(i));
+    }
+    std::sort(candidates.begin(), candidates.end());
+    std::vector<std::string> splits;
+    if (parts < 2 || candidates.size() < parts)
+        return splits;
+    for (size_t k = 1; k < parts; ++k) {
+        auto key = candidates[k * candidates.size() / parts];
+        if (splits.empty() || key > splits.back())
+            splits.emplace_back(key);
+    }
+    return splits;
+}
+
+}  // namespace DB
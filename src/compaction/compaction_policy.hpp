@@ -0,0 +1,113 @@
+#ifndef COMPACTION_POLICY_HPP_
+#define COMPACTION_POLICY_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../configs/db_config.hpp"
+#include "../sstable/sstable.hpp"
+#include "compaction_style.hpp"
+
+namespace DB {
+
+// Tables per level. Level 0 is ordered oldest first and its tables may
+// overlap; every other level is sorted by key with disjoint key ranges.
+using LevelTables = std::vector<std::vector<std::shared_ptr<SSTable>>>;
+
+struct CompactionJob {
+    int level = 0;
+    int outputLevel = 0;
+    // Urgency; a job is only picked once its score reaches 1.
+    double score = 0;
+    // Newest first, the order MergingIterator expects.
+    std::vector<std::shared_ptr<SSTable>> inputs;
+    // True when nothing older than the inputs can hold the same keys.
+    bool dropTombstones = false;
+    // Outputs are cut at this size; 0 writes a single table.
+    uint64_t targetFileBytes = 0;
+    // The single input can move to outputLevel without being rewritten.
+    bool trivialMove = false;
+};
+
+// Decides which tables to merge next and where the results go. Only one
+// compaction runs at a time, and both calls are made under db_mutex.
+class CompactionPolicy {
+public:
+    virtual ~CompactionPolicy() = default;
+
+    // The highest-scoring compaction for `levels`, if any scores >= 1.
+    virtual std::optional<CompactionJob> pick(const LevelTables &levels) = 0;
+
+    // Replaces the job's inputs in `levels` with `outputs`. Tables flushed
+    // since the job was picked are still in `levels` and must be kept.
+    virtual void install(
+        LevelTables &levels,
+        const CompactionJob &job,
+        std::vector<std::shared_ptr<SSTable>> outputs
+    ) const = 0;
+};
+
+class LeveledCompactionPolicy final : public CompactionPolicy {
+public:
+    explicit LeveledCompactionPolicy(
+        size_t l0CompactionTrigger = DBConfig::kL0CompactionTrigger,
+        uint64_t level1MaxBytes = DBConfig::kLevel1MaxBytes,
+        double levelSizeMultiplier = DBConfig::kLevelSizeMultiplier,
+        uint64_t targetFileBytes = DBConfig::kTargetFileBytes
+    );
+
+    std::optional<CompactionJob> pick(const LevelTables &levels) override;
+    void install(
+        LevelTables &levels,
+        const CompactionJob &job,
+        std::vector<std::shared_ptr<SSTable>> outputs
+    ) const override;
+
+private:
+    size_t l0CompactionTrigger_;
+    uint64_t level1MaxBytes_;
+    double levelSizeMultiplier_;
+    uint64_t targetFileBytes_;
+    // Largest key of the last table compacted out of each level, so
+    // successive compactions walk the key space round-robin.
+    std::vector<std::string> compactPointer_;
+
+    uint64_t maxBytesForLevel(int level) const;
+};
+
+class SizeTieredCompactionPolicy final : public CompactionPolicy {
+public:
+    explicit SizeTieredCompactionPolicy(
+        size_t minMergeWidth = DBConfig::kTieredMinMergeWidth,
+        double sizeRatio = DBConfig::kTieredSizeRatio,
+        size_t maxRuns = DBConfig::kTieredMaxRuns
+    );
+
+    std::optional<CompactionJob> pick(const LevelTables &levels) override;
+    void install(
+        LevelTables &levels,
+        const CompactionJob &job,
+        std::vector<std::shared_ptr<SSTable>> outputs
+    ) const override;
+
+private:
+    size_t minMergeWidth_;
+    double sizeRatio_;
+    size_t maxRuns_;
+};
+
+std::unique_ptr<CompactionPolicy> makeCompactionPolicy(CompactionStyle style);
+
+// Up to parts - 1 increasing keys that cut the job's key space into ranges
+// holding roughly the same number of input blocks. Candidates are the last
+// keys of the inputs' index blocks.
+std::vector<std::string> subcompactionSplits(
+    const CompactionJob &job,
+    size_t parts
+);
+
+}  // namespace DB
+
+#endif  // COMPACTION_POLICY_HPP_
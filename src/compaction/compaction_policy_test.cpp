@@ -0,0 +1,360 @@
+#include "compaction_policy.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <userver/fs/blocking/temp_directory.hpp>
+#include <userver/utest/utest.hpp>
+#include "../sstable/sstable_builder.hpp"
+
+namespace DB {
+
+namespace {
+
+using Table = std::shared_ptr<SSTable>;
+
+std::string key(char prefix, int i) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%c%05d", prefix, i);
+    return buf;
+}
+
+// Writes hand-built tables into a temporary directory.
+class Tables {
+public:
+    // Keys prefix+first .. prefix+last with values of `valueSize` bytes that
+    // do not compress, so file sizes follow the key count.
+    Table make(char prefix, int first, int last, size_t valueSize = 100) {
+        auto path = dir_.GetPath() + "/sstable_" + std::to_string(next_++) +
+                    ".dat";
+        SSTableBuilder builder(path);
+        for (int i = first; i <= last; ++i) {
+            builder.add(key(prefix, i), DBEntry{noise(valueSize), false});
+        }
+        builder.finish();
+        return std::make_shared<SSTable>(path);
+    }
+
+    // A table of `count` keys under `prefix`.
+    Table sized(char prefix, int count) {
+        return make(prefix, 0, count - 1);
+    }
+
+private:
+    userver::fs::blocking::TempDirectory dir_ =
+        userver::fs::blocking::TempDirectory::Create();
+    int next_ = 0;
+    uint64_t seed_ = 0x9e3779b97f4a7c15ull;
+
+    std::vector<uint8_t> noise(size_t size) {
+        std::vector<uint8_t> bytes(size);
+        for (auto &b : bytes) {
+            seed_ ^= seed_ << 13;
+            seed_ ^= seed_ >> 7;
+            seed_ ^= seed_ << 17;
+            b = static_cast<uint8_t>(seed_);
+        }
+        return bytes;
+    }
+};
+
+LevelTables emptyLevels() {
+    return LevelTables(4);
+}
+
+bool contains(const std::vector<Table> &tables, const Table &t) {
+    return std::find(tables.begin(), tables.end(), t) != tables.end();
+}
+
+// A level-1 budget every hand-built table exceeds, and deeper levels that
+// never fill up.
+LeveledCompactionPolicy smallLeveled() {
+    return LeveledCompactionPolicy(4, 1, 1e9, 0);
+}
+
+}  // namespace
+
+TEST(LeveledCompaction, WaitsForL0Trigger) {
+    Tables tables;
+    auto levels = emptyLevels();
+    LeveledCompactionPolicy policy(4, 1ull << 40, 10, 0);
+    for (int i = 0; i < 3; ++i) {
+        levels[0].push_back(tables.make('a', i * 10, i * 10 + 20));
+    }
+    EXPECT_FALSE(policy.pick(levels));
+
+    levels[0].push_back(tables.make('a', 30, 50));
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_EQ(job->level, 0);
+    EXPECT_EQ(job->outputLevel, 1);
+    EXPECT_DOUBLE_EQ(job->score, 1);
+    EXPECT_FALSE(job->trivialMove);
+    // All of L0, newest first.
+    std::vector<Table> expected(levels[0].rbegin(), levels[0].rend());
+    EXPECT_EQ(job->inputs, expected);
+}
+
+TEST(LeveledCompaction, L0PullsInOverlappingL1Tables) {
+    Tables tables;
+    auto levels = emptyLevels();
+    LeveledCompactionPolicy policy(2, 1ull << 40, 10, 1000);
+    levels[0].push_back(tables.make('b', 10, 20));
+    levels[0].push_back(tables.make('b', 15, 30));
+    auto before = tables.make('a', 0, 10);
+    auto inside = tables.make('b', 0, 12);
+    auto after = tables.make('c', 0, 10);
+    levels[1] = {before, inside, after};
+
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_EQ(job->targetFileBytes, 1000u);
+    ASSERT_EQ(job->inputs.size(), 3u);
+    EXPECT_EQ(job->inputs[0], levels[0][1]);
+    EXPECT_EQ(job->inputs[1], levels[0][0]);
+    EXPECT_EQ(job->inputs[2], inside);
+    EXPECT_TRUE(job->dropTombstones);
+}
+
+TEST(LeveledCompaction, KeepsTombstonesAboveOverlappingData) {
+    Tables tables;
+    auto levels = emptyLevels();
+    LeveledCompactionPolicy policy(1, 1ull << 40, 10, 0);
+    levels[0].push_back(tables.make('b', 0, 10));
+    // Older versions of the same keys two levels down.
+    levels[2].push_back(tables.make('b', 5, 6));
+
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_EQ(job->outputLevel, 1);
+    EXPECT_FALSE(job->dropTombstones);
+
+    // Data below that does not overlap cannot be hidden by the tombstones.
+    levels[2] = {tables.make('c', 0, 10)};
+    job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_TRUE(job->dropTombstones);
+}
+
+TEST(LeveledCompaction, PicksTheHighestScore) {
+    Tables tables;
+    auto levels = emptyLevels();
+    // L0 at 5/4 of its trigger; L1 far over its one-byte budget.
+    auto policy = smallLeveled();
+    for (int i = 0; i < 5; ++i) {
+        levels[0].push_back(tables.make('a', i, i + 1));
+    }
+    levels[1].push_back(tables.make('b', 0, 10));
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_EQ(job->level, 1);
+    EXPECT_GT(job->score, 5.0 / 4);
+}
+
+TEST(LeveledCompaction, TrivialMoveAndInstall) {
+    Tables tables;
+    auto levels = emptyLevels();
+    auto policy = smallLeveled();
+    auto a = tables.make('a', 0, 10);
+    auto b = tables.make('b', 0, 10);
+    levels[1] = {a, b};
+    auto below = tables.make('c', 0, 10);
+    levels[2] = {below};
+
+    // Nothing in L2 overlaps `a`, so it moves down without a rewrite.
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_EQ(job->level, 1);
+    EXPECT_TRUE(job->trivialMove);
+    ASSERT_EQ(job->inputs.size(), 1u);
+    EXPECT_EQ(job->inputs[0], a);
+
+    policy.install(levels, *job, job->inputs);
+    EXPECT_EQ(levels[1], std::vector<Table>{b});
+    // Sorted by key in the output level.
+    EXPECT_EQ(levels[2], (std::vector<Table>{a, below}));
+}
+
+TEST(LeveledCompaction, WalksLevelRoundRobin) {
+    Tables tables;
+    auto levels = emptyLevels();
+    auto policy = smallLeveled();
+    auto a = tables.make('a', 0, 10);
+    auto b = tables.make('b', 0, 10);
+    auto c = tables.make('c', 0, 10);
+    levels[1] = {a, b, c};
+    // One overlapping L2 table under each, so nothing is a trivial move.
+    levels[2] = {
+        tables.make('a', 5, 6), tables.make('b', 5, 6), tables.make('c', 5, 6)};
+
+    std::vector<Table> picked;
+    for (int i = 0; i < 4; ++i) {
+        auto job = policy.pick(levels);
+        ASSERT_TRUE(job);
+        EXPECT_FALSE(job->trivialMove);
+        ASSERT_EQ(job->inputs.size(), 2u);
+        EXPECT_EQ(job->inputs[1], levels[2][i % 3]);
+        picked.push_back(job->inputs[0]);
+    }
+    EXPECT_EQ(picked, (std::vector<Table>{a, b, c, a}));
+}
+
+TEST(LeveledCompaction, InstallKeepsTablesFlushedMeanwhile) {
+    Tables tables;
+    auto levels = emptyLevels();
+    LeveledCompactionPolicy policy(2, 1ull << 40, 10, 0);
+    levels[0] = {tables.make('a', 0, 10), tables.make('a', 5, 15)};
+    auto old = tables.make('a', 8, 9);
+    levels[1] = {old};
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+
+    auto flushed = tables.make('z', 0, 1);
+    levels[0].push_back(flushed);
+    auto outB = tables.make('b', 0, 1);
+    auto outA = tables.make('a', 0, 15);
+    policy.install(levels, *job, {outB, outA});
+    EXPECT_EQ(levels[0], std::vector<Table>{flushed});
+    EXPECT_EQ(levels[1], (std::vector<Table>{outA, outB}));
+    EXPECT_FALSE(contains(levels[1], old));
+}
+
+TEST(SizeTieredCompaction, MergesSimilarNeighbours) {
+    Tables tables;
+    auto levels = emptyLevels();
+    SizeTieredCompactionPolicy policy(4, 2.0, 10);
+    // One big old run, then four similar newer ones.
+    levels[0].push_back(tables.sized('a', 2000));
+    for (int i = 0; i < 4; ++i) {
+        levels[0].push_back(tables.sized('a', 100 + i * 10));
+    }
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_DOUBLE_EQ(job->score, 1);
+    EXPECT_EQ(job->targetFileBytes, 0u);
+    // The window, newest first.
+    std::vector<Table> expected(levels[0].rbegin(), levels[0].rend() - 1);
+    EXPECT_EQ(job->inputs, expected);
+    // The big run is older and may hold what the tombstones hide.
+    EXPECT_FALSE(job->dropTombstones);
+}
+
+TEST(SizeTieredCompaction, OldestWindowDropsTombstones) {
+    Tables tables;
+    auto levels = emptyLevels();
+    SizeTieredCompactionPolicy policy(4, 2.0, 10);
+    for (int i = 0; i < 5; ++i) {
+        levels[0].push_back(tables.sized('a', 100));
+    }
+    levels[0].push_back(tables.sized('a', 2000));
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_DOUBLE_EQ(job->score, 5.0 / 4);
+    std::vector<Table> expected(levels[0].rbegin() + 1, levels[0].rend());
+    EXPECT_EQ(job->inputs, expected);
+    EXPECT_TRUE(job->dropTombstones);
+}
+
+TEST(SizeTieredCompaction, WaitsForEnoughSimilarRuns) {
+    Tables tables;
+    auto levels = emptyLevels();
+    SizeTieredCompactionPolicy policy(4, 2.0, 10);
+    for (int count : {100, 100, 100, 1000, 100}) {
+        levels[0].push_back(tables.sized('a', count));
+    }
+    EXPECT_FALSE(policy.pick(levels));
+}
+
+TEST(SizeTieredCompaction, MergesCheapestWindowWhenTooManyRuns) {
+    Tables tables;
+    auto levels = emptyLevels();
+    SizeTieredCompactionPolicy policy(2, 1.5, 3);
+    // Each run three times the next, so no two are similar.
+    for (int count : {2700, 900, 300, 100}) {
+        levels[0].push_back(tables.sized('a', count));
+    }
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_DOUBLE_EQ(job->score, 4.0 / 3);
+    EXPECT_EQ(job->inputs, (std::vector<Table>{levels[0][3], levels[0][2]}));
+    EXPECT_FALSE(job->dropTombstones);
+}
+
+TEST(SizeTieredCompaction, InstallKeepsRunOrder) {
+    Tables tables;
+    auto levels = emptyLevels();
+    SizeTieredCompactionPolicy policy(2, 2.0, 10);
+    auto big = tables.sized('a', 2000);
+    auto s1 = tables.sized('a', 100);
+    auto s2 = tables.sized('a', 100);
+    levels[0] = {big, s1, s2};
+    auto job = policy.pick(levels);
+    ASSERT_TRUE(job);
+    EXPECT_EQ(job->inputs, (std::vector<Table>{s2, s1}));
+
+    auto flushed = tables.sized('b', 10);
+    levels[0].push_back(flushed);
+    auto merged = tables.sized('a', 200);
+    policy.install(levels, *job, {merged});
+    EXPECT_EQ(levels[0], (std::vector<Table>{big, merged, flushed}));
+}
+
+TEST(SubcompactionSplits, NoSplitsForOnePartOrFewBlocks) {
+    Tables tables;
+    CompactionJob job;
+    job.inputs = {tables.make('a', 0, 1)};
+    EXPECT_TRUE(subcompactionSplits(job, 1).empty());
+    EXPECT_TRUE(subcompactionSplits(job, 4).empty());
+}
+
+TEST(SubcompactionSplits, CutsAtBlockBoundaries) {
+    Tables tables;
+    CompactionJob job;
+    job.inputs = {tables.make('a', 0, 999), tables.make('a', 500, 1499)};
+    std::vector<std::string> lastKeys;
+    for (const auto &t : job.inputs) {
+        const auto &index = t->GetIndex();
+        ASSERT_GT(index.size(), 8u);
+        for (size_t i = 0; i < index.size(); ++i) {
+            lastKeys.emplace_back(index.lastKey(i));
+        }
+    }
+    std::sort(lastKeys.begin(), lastKeys.end());
+
+    auto splits = subcompactionSplits(job, 4);
+    ASSERT_EQ(splits.size(), 3u);
+    for (size_t i = 0; i < splits.size(); ++i) {
+        EXPECT_TRUE(std::binary_search(
+            lastKeys.begin(), lastKeys.end(), splits[i]
+        )) << splits[i];
+        if (i > 0) {
+            EXPECT_LT(splits[i - 1], splits[i]);
+        }
+        // Each range gets about a quarter of the blocks.
+        auto below = std::upper_bound(
+                         lastKeys.begin(), lastKeys.end(), splits[i]
+                     ) -
+                     lastKeys.begin();
+        EXPECT_NEAR(
+            static_cast<double>(below) / lastKeys.size(), (i + 1) / 4.0, 0.1
+        );
+    }
+}
+
+TEST(SubcompactionSplits, SkipsDuplicateBoundaries) {
+    Tables tables;
+    CompactionJob job;
+    // Identical tables: every candidate key appears twice.
+    auto t = tables.make('a', 0, 99);
+    job.inputs = {t, t};
+    size_t blocks = t->GetIndex().size();
+    auto splits = subcompactionSplits(job, blocks * 2);
+    ASSERT_FALSE(splits.empty());
+    for (size_t i = 1; i < splits.size(); ++i) {
+        EXPECT_LT(splits[i - 1], splits[i]);
+    }
+    EXPECT_LT(splits.size(), blocks * 2 - 1);
+}
+
+}  // namespace DB
@@ -0,0 +1,19 @@
+#ifndef COMPACTION_STYLE_HPP_
+#define COMPACTION_STYLE_HPP_
+
+namespace DB {
+
+// How SSTables are organized and merged in the background.
+enum class CompactionStyle {
+    // L0 holds freshly flushed, overlapping tables; every deeper level is a
+    // single sorted run kLevelSizeMultiplier times larger than the previous
+    // one. Low read and space amplification.
+    kLeveled,
+    // Every table is its own sorted run in L0; runs of similar size that
+    // are adjacent in age are merged together. Low write amplification.
+    kSizeTiered,
+};
+
+}  // namespace DB
+
+#endif  // COMPACTION_STYLE_HPP_
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string_view>
+#include <userver/components/component_config.hpp>
+#include <userver/components/component_context.hpp>
+#include <userver/components/component_base.hpp>
+#include "../base/database.hpp"
+#include "../configs/db_config.hpp"
+
+namespace userver_db {
+
+// Owns the single Database instance shared by all handlers.
+class DatabaseComponent final
+    : public userver::components::ComponentBase {
+public:
+    static constexpr std::string_view kName = "database";
+
+    DatabaseComponent(
+        const userver::components::ComponentConfig &config,
+        const userver::components::ComponentContext &context
+    )
+        : ComponentBase(config, context),
+          db_(DBConfig::kDirectory,
+              DBConfig::kMemtableBytes,
+              context.GetTaskProcessor(DBConfig::kFlushTaskProcessor),
+              context.GetTaskProcessor(DBConfig::kCompactionTaskProcessor),
+              context.GetTaskProcessor(DBConfig::kFsTaskProcessor)) {
+    }
+
+    DB::Database &GetDatabase() {
+        return db_;
+    }
+
+private:
+    DB::Database db_;
+};
+
+}  // namespace userver_db
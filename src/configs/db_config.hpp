@@ -1,13 +1,110 @@
 #ifndef DB_CONFIG_HPP_
 #define DB_CONFIG_HPP_
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include "../bloom/filter_type.hpp"
+#include "../bloom/prefix_extractor.hpp"
+#include "../compaction/compaction_style.hpp"
+#include "../sstable/compression_type.hpp"
+#include "../wal/wal_sync_mode.hpp"
 
 namespace DBConfig {
 
 constexpr const char *kDirectory = "database";
-constexpr std::size_t kMemtableLimit = 1000;
-constexpr std::size_t kSstableLimit = 2;
+// Approximate memtable size (keys, values and node overhead) that triggers a
+// flush.
+constexpr std::size_t kMemtableBytes = 4 * 1024 * 1024;
+// Leveled compaction: L0 is compacted into L1 once it holds this many
+// tables; Ln (n >= 1) once it exceeds kLevel1MaxBytes *
+// kLevelSizeMultiplier^(n-1).
+constexpr DB::CompactionStyle kCompactionStyle = DB::CompactionStyle::kLeveled;
+constexpr int kNumLevels = 7;
+constexpr std::size_t kL0CompactionTrigger = 4;
+constexpr std::uint64_t kLevel1MaxBytes = 64 * 1024 * 1024;
+constexpr double kLevelSizeMultiplier = 10;
+// Leveled compactions start a new output table once the current one reaches
+// this size.
+constexpr std::uint64_t kTargetFileBytes = 8 * 1024 * 1024;
+// Leveled compactions are split by key range into up to kMaxSubcompactions
+// parallel tasks of at least kMinSubcompactionBytes of input each.
+constexpr std::size_t kMaxSubcompactions = 4;
+constexpr std::uint64_t kMinSubcompactionBytes = 4 * 1024 * 1024;
+// Size-tiered compaction: merges at least kTieredMinMergeWidth age-adjacent
+// runs whose sizes are within kTieredSizeRatio of their average, or the
+// cheapest kTieredMinMergeWidth neighbours once there are more than
+// kTieredMaxRuns runs.
+constexpr std::size_t kTieredMinMergeWidth = 4;
+constexpr double kTieredSizeRatio = 2.0;
+constexpr std::size_t kTieredMaxRuns = 6;
+// Target size of an SSTable data block, the unit of disk reads.
+constexpr std::size_t kSstableBlockSize = 4 * 1024;
+// Keys inside a block are delta-encoded against the previous key and stored
+// in full every this many records.
+constexpr std::size_t kBlockRestartInterval = 16;
+// Bloom filter density for new tables: kFilterBitsPerKey bits per key, or,
+// when kFilterTargetFpr is above zero, whatever that false-positive rate
+// needs. The probe count follows from the density.
+constexpr double kFilterBitsPerKey = 10;
+constexpr double kFilterTargetFpr = 0;
+// Filter type for tables written to each level. Deep levels hold most of the
+// keys and are read least, so they use the smaller XOR filter; the type is
+// recorded per table, so changing this only affects new tables.
+constexpr DB::FilterType kFilterTypeByLevel[] = {
+    DB::FilterType::kBloom, DB::FilterType::kBloom, DB::FilterType::kXor8,
+    DB::FilterType::kXor8,  DB::FilterType::kXor8,  DB::FilterType::kXor8,
+    DB::FilterType::kXor8};
+static_assert(
+    sizeof(kFilterTypeByLevel) / sizeof(kFilterTypeByLevel[0]) == kNumLevels,
+    "one filter type per level"
+);
+// Key prefixes added to table filters so prefix scans can skip tables
+// without matching keys, e.g. PrefixExtractor::delimited(':', 2) for
+// "tenant:<id>:..." keys or PrefixExtractor::fixed(8). A prefix scan only
+// benefits when its prefix is at least as long as the extracted one.
+// Tables keep the extractor they were written with; after a change, older
+// tables are scanned until compaction rewrites them.
+constexpr DB::PrefixExtractor kPrefixExtractor = DB::PrefixExtractor::none();
+// Codec for new data blocks. Falls back to kNone when the codec was not
+// found at build time; existing tables keep whatever codec they were written
+// with. The level only applies to kZstd.
+constexpr DB::CompressionType kSstableCompression = DB::CompressionType::kLz4;
+constexpr int kSstableCompressionLevel = 3;
+// Largest readahead used by sequential SSTable scans (merges, snapshots).
+constexpr std::size_t kIteratorReadahead = 1024 * 1024;
+// Shared cache of SSTable blocks; table indexes and filters are charged to it
+// as well.
+constexpr std::size_t kBlockCacheBytes = 64 * 1024 * 1024;
+constexpr std::size_t kBlockCacheShards = 16;
+constexpr const char *kFlushTaskProcessor = "flush-task-processor";
+// Runs blocking file I/O such as opening tables at startup.
+constexpr const char *kFsTaskProcessor = "fs-task-processor";
+constexpr const char *kCompactionTaskProcessor = "compaction-task-processor";
+
+// Budget for background I/O (flush and compaction reads and writes); 0
+// disables limiting. Adjusted every kRateLimiterTuneInterval within
+// [min, max]: lowered while the EWMA of GET and scan latency exceeds
+// kForegroundLatencyTarget and raised again once it falls below half of it.
+constexpr std::uint64_t kBackgroundIoBytesPerSec = 64 * 1024 * 1024;
+constexpr std::uint64_t kBackgroundIoMinBytesPerSec = 8 * 1024 * 1024;
+constexpr std::uint64_t kBackgroundIoMaxBytesPerSec = 512 * 1024 * 1024;
+constexpr std::chrono::microseconds kForegroundLatencyTarget{2000};
+constexpr std::chrono::milliseconds kRateLimiterTuneInterval{1000};
+
+// WAL durability: kNone, kOsBuffered, kFsyncPerBatch or kFsyncPeriodic (the
+// latter syncs every kWalSyncInterval).
+constexpr DB::WalSyncMode kWalSyncMode = DB::WalSyncMode::kFsyncPerBatch;
+constexpr std::chrono::milliseconds kWalSyncInterval{100};
+
+// Write backpressure. Past a slowdown threshold every write is delayed by
+// kWriteSlowdownDelay; past a stop threshold writes block until flushes or
+// compactions catch up. The L0 triggers count level-0 tables.
+constexpr std::size_t kImmutableSlowdownTrigger = 2;
+constexpr std::size_t kImmutableStopTrigger = 4;
+constexpr std::size_t kL0SlowdownTrigger = 8;
+constexpr std::size_t kL0StopTrigger = 12;
+constexpr std::chrono::microseconds kWriteSlowdownDelay{1000};
 
 }  // namespace DBConfig
 
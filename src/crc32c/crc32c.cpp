@@ -0,0 +1,76 @@
+#include "crc32c.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CLARITY_CRC32C_SSE42 1
+#endif
+
+namespace DB {
+namespace crc32c {
+
+namespace {
+
+constexpr uint32_t kPoly = 0x82f63b78u;
+
+std::array<uint32_t, 256> makeTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? (c >> 1) ^ kPoly : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+uint32_t extendPortable(uint32_t crc, const uint8_t *p, size_t size) {
+    static const std::array<uint32_t, 256> table = makeTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#ifdef CLARITY_CRC32C_SSE42
+__attribute__((target("sse4.2"))) uint32_t
+extendSse42(uint32_t crc, const uint8_t *p, size_t size) {
+    uint64_t c = ~crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        c = _mm_crc32_u64(c, word);
+        p += 8;
+        size -= 8;
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    while (size > 0) {
+        c32 = _mm_crc32_u8(c32, *p++);
+        --size;
+    }
+    return ~c32;
+}
+
+bool hasSse42() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#endif
+
+}  // namespace
+
+uint32_t extend(uint32_t crc, const void *data, size_t size) {
+    const auto *p = static_cast<const uint8_t *>(data);
+#ifdef CLARITY_CRC32C_SSE42
+    if (hasSse42()) {
+        return extendSse42(crc, p, size);
+    }
+#endif
+    return extendPortable(crc, p, size);
+}
+
+}  // namespace crc32c
+}  // namespace DB
@@ -0,0 +1,32 @@
+#ifndef CRC32C_HPP_
+#define CRC32C_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DB {
+namespace crc32c {
+
+// CRC-32C (Castagnoli). Uses the SSE4.2 crc32 instruction when the CPU has
+// it and a table-driven fallback otherwise.
+uint32_t extend(uint32_t crc, const void *data, size_t size);
+
+inline uint32_t value(const void *data, size_t size) {
+    return extend(0, data, size);
+}
+
+// A CRC stored next to the data it covers is masked, so that computing the
+// CRC of a buffer that embeds CRCs does not degenerate.
+inline uint32_t mask(uint32_t crc) {
+    return ((crc >> 15) | (crc << 17)) + 0xa282ead8u;
+}
+
+inline uint32_t unmask(uint32_t masked) {
+    uint32_t rot = masked - 0xa282ead8u;
+    return (rot >> 17) | (rot << 15);
+}
+
+}  // namespace crc32c
+}  // namespace DB
+
+#endif  // CRC32C_HPP_
@@ -45,8 +45,9 @@ userver::formats::json::Value DatabaseHandler::
                 "Key not found"});
         }
 
-        std::string serialized(opt_blob->begin(), opt_blob->end());
-        auto json_value = FromString(serialized);
+        auto json_value = FromString(std::string_view(
+            reinterpret_cast<const char *>(opt_blob->data()), opt_blob->size()
+        ));
 
         response["key"] = key;
         response["value"] = json_value;
@@ -58,10 +59,10 @@ userver::formats::json::Value DatabaseHandler::
         std::string serialized = ToString(json_value);
 
         std::vector<uint8_t> blob(serialized.begin(), serialized.end());
-        db_.insert(key, blob);
 
         response["updated_key"] = key;
         response["updated_value"] = json_value;
+        db_.insert(std::move(key), std::move(blob));
         return response.ExtractValue();
     }
 
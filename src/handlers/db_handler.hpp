@@ -7,7 +7,7 @@
 #include <userver/server/http/http_request.hpp>
 #include <userver/server/request/request_context.hpp>
 #include "../base/database.hpp"
-#include "../configs/db_config.hpp"
+#include "../components/database_component.hpp"
 #include "snapshot_handler.hpp"
 
 namespace userver_db {
@@ -17,7 +17,13 @@ class DatabaseHandler final
 public:
     static constexpr std::string_view kName = "handler-database";
 
-    using HttpHandlerJsonBase::HttpHandlerJsonBase;
+    DatabaseHandler(
+        const userver::components::ComponentConfig &config,
+        const userver::components::ComponentContext &context
+    )
+        : HttpHandlerJsonBase(config, context),
+          db_(context.FindComponent<DatabaseComponent>().GetDatabase()) {
+    }
 
     userver::formats::json::Value HandleRequestJsonThrow(
         const userver::server::http::HttpRequest &request,
@@ -26,9 +32,7 @@ public:
     ) const override;
 
 private:
-    mutable DB::Database db_{
-        DBConfig::kDirectory, DBConfig::kMemtableLimit,
-        DBConfig::kSstableLimit};
+    DB::Database &db_;
 };
 
 }  // namespace userver_db
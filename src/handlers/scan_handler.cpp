@@ -0,0 +1,80 @@
+#include "scan_handler.hpp"
+#include <algorithm>
+#include <userver/formats/json/serialize.hpp>
+#include <userver/formats/json/value_builder.hpp>
+#include <userver/server/handlers/exceptions.hpp>
+
+using userver::formats::json::FromString;
+
+namespace userver_db {
+
+namespace {
+struct error_builder {
+    static constexpr bool kIsExternalBodyFormatted = true;
+    std::string message;
+
+    std::string GetExternalBody() const {
+        return message;
+    }
+};
+
+size_t ParseLimit(const std::string &raw) {
+    if (raw.empty()) {
+        return ScanHandler::kDefaultLimit;
+    }
+    size_t limit = 0;
+    try {
+        size_t pos = 0;
+        limit = std::stoull(raw, &pos);
+        if (pos != raw.size()) {
+            limit = 0;
+        }
+    } catch (const std::exception &) {
+        limit = 0;
+    }
+    if (limit == 0 || raw.front() == '-') {
+        throw userver::server::handlers::ClientError(error_builder{
+            "Invalid limit"});
+    }
+    return std::min(limit, ScanHandler::kMaxLimit);
+}
+}  // namespace
+
+userver::formats::json::Value ScanHandler::
+    HandleRequestJsonThrow(const userver::server::http::HttpRequest &request, const userver::formats::json::Value &, userver::server::request::RequestContext &)
+        const {
+    const size_t limit = ParseLimit(request.GetArg("limit"));
+    const std::string &cursor = request.GetArg("cursor");
+
+    // One extra entry tells whether another page exists.
+    DB::Database::ScanResult items;
+    if (request.HasArg("prefix")) {
+        items = db_.prefixScan(request.GetArg("prefix"), limit + 1, cursor);
+    } else {
+        const std::string &start = request.GetArg("start");
+        items = db_.scan(
+            std::max(start, cursor), request.GetArg("end"), limit + 1
+        );
+    }
+
+    userver::formats::json::ValueBuilder response;
+    if (items.size() > limit) {
+        response["next_cursor"] = items.back().first;
+        items.pop_back();
+    }
+    userver::formats::json::ValueBuilder list(
+        userver::formats::json::Type::kArray
+    );
+    for (const auto &[key, blob] : items) {
+        userver::formats::json::ValueBuilder item;
+        item["key"] = key;
+        item["value"] = FromString(std::string_view(
+            reinterpret_cast<const char *>(blob.data()), blob.size()
+        ));
+        list.PushBack(std::move(item));
+    }
+    response["items"] = list.ExtractValue();
+    return response.ExtractValue();
+}
+
+}  // namespace userver_db
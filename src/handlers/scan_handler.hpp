@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string_view>
+#include <userver/formats/json/value.hpp>
+#include <userver/server/handlers/http_handler_json_base.hpp>
+#include <userver/server/http/http_request.hpp>
+#include <userver/server/request/request_context.hpp>
+#include "../base/database.hpp"
+#include "../components/database_component.hpp"
+
+namespace userver_db {
+
+// GET /database?start=&end=&prefix=&limit=&cursor=
+//
+// Returns live entries in key order. `next_cursor` is present when more
+// entries remain and is passed back as `cursor` to fetch the next page.
+class ScanHandler final
+    : public userver::server::handlers::HttpHandlerJsonBase {
+public:
+    static constexpr std::string_view kName = "handler-scan";
+    static constexpr size_t kDefaultLimit = 100;
+    static constexpr size_t kMaxLimit = 1000;
+
+    ScanHandler(
+        const userver::components::ComponentConfig &config,
+        const userver::components::ComponentContext &context
+    )
+        : HttpHandlerJsonBase(config, context),
+          db_(context.FindComponent<DatabaseComponent>().GetDatabase()) {
+    }
+
+    userver::formats::json::Value HandleRequestJsonThrow(
+        const userver::server::http::HttpRequest &request,
+        const userver::formats::json::Value &request_json,
+        userver::server::request::RequestContext &request_context
+    ) const override;
+
+private:
+    DB::Database &db_;
+};
+
+}  // namespace userver_db
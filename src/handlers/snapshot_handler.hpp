@@ -4,6 +4,7 @@
 #include <string>
 #include <userver/server/handlers/http_handler_json_base.hpp>
 #include "../base/database.hpp"
+#include "../components/database_component.hpp"
 #include "../configs/db_config.hpp"
 
 namespace userver_db {
@@ -12,12 +13,18 @@ class SnapshotHandler final
     : public userver::server::handlers::HttpHandlerJsonBase {
 public:
     static constexpr std::string_view kName = "handler-snapshot";
-    using HttpHandlerJsonBase::HttpHandlerJsonBase;
+
+    SnapshotHandler(
+        const userver::components::ComponentConfig &config,
+        const userver::components::ComponentContext &context
+    )
+        : HttpHandlerJsonBase(config, context),
+          db_(context.FindComponent<DatabaseComponent>().GetDatabase()) {
+    }
 
     userver::formats::json::Value
     HandleRequestJsonThrow(const userver::server::http::HttpRequest &request, const userver::formats::json::Value &request_json, userver::server::request::RequestContext &)
         const override {
-        db_.recoverFromWAL();
         const std::string csv_path =
             std::string(DBConfig::kDirectory) + "/snapshot.csv";
         db_.SnapshotCsv(csv_path);
@@ -31,9 +38,7 @@ public:
     }
 
 private:
-    mutable DB::Database db_{
-        DBConfig::kDirectory, DBConfig::kMemtableLimit,
-        DBConfig::kSstableLimit};
+    DB::Database &db_;
 };
 
 }  // namespace userver_db
\ No newline at end of file
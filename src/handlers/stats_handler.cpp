@@ -0,0 +1,33 @@
+#include "stats_handler.hpp"
+#include <userver/formats/json/value_builder.hpp>
+
+namespace userver_db {
+
+userver::formats::json::Value StatsHandler::
+    HandleRequestJsonThrow(const userver::server::http::HttpRequest &, const userver::formats::json::Value &, userver::server::request::RequestContext &)
+        const {
+    userver::formats::json::ValueBuilder response;
+
+    const auto cache = db_.blockCacheStats();
+    userver::formats::json::ValueBuilder blockCache;
+    blockCache["hits"] = cache.hits;
+    blockCache["misses"] = cache.misses;
+    blockCache["evictions"] = cache.evictions;
+    blockCache["usage_bytes"] = cache.usage;
+    blockCache["pinned_bytes"] = cache.pinnedUsage;
+    blockCache["capacity_bytes"] = cache.capacity;
+    response["block_cache"] = blockCache.ExtractValue();
+
+    const auto io = db_.backgroundIoStats();
+    userver::formats::json::ValueBuilder backgroundIo;
+    backgroundIo["bytes_per_second"] = io.bytesPerSecond;
+    backgroundIo["bytes"] = io.bytes;
+    backgroundIo["throttled_requests"] = io.throttledRequests;
+    backgroundIo["throttled_time_us"] = static_cast<uint64_t>(io.throttledTime.count());
+    backgroundIo["foreground_latency_us"] = static_cast<uint64_t>(io.foregroundLatency.count());
+    response["background_io"] = backgroundIo.ExtractValue();
+
+    return response.ExtractValue();
+}
+
+}  // namespace userver_db
@@ -0,0 +1,34 @@
+#ifndef KV_ITERATOR_HPP_
+#define KV_ITERATOR_HPP_
+
+#include <string_view>
+#include "../base/db_entry.hpp"
+
+namespace DB {
+
+// Ordered cursor over one source of entries (memtable, SSTable, or a merge of
+// several). Tombstones are returned like any other entry; key() and entry()
+// are valid until the next call that moves the iterator. An iterator that
+// hits an unreadable or corrupt block becomes invalid and reports it through
+// ok(), so callers can tell a read error from the end of the data.
+class KVIterator {
+public:
+    virtual ~KVIterator() = default;
+
+    virtual bool valid() const = 0;
+    virtual void seekToFirst() = 0;
+    // Positions at the first key not less than `target`.
+    virtual void seek(std::string_view target) = 0;
+    virtual void next() = 0;
+    virtual std::string_view key() const = 0;
+    virtual const DBEntry &entry() const = 0;
+    // False once a read error was hit; it stays false. Whatever was
+    // returned before may then be incomplete.
+    virtual bool ok() const {
+        return true;
+    }
+};
+
+}  // namespace DB
+
+#endif  // KV_ITERATOR_HPP_
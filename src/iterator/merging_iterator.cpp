@@ -0,0 +1,107 @@
+#include "merging_iterator.hpp"
+#include <algorithm>
+
+namespace DB {
+
+MergingIterator::MergingIterator(
+    std::vector<std::unique_ptr<KVIterator>> children
+)
+    : children_(std::move(children)) {
+    heap_.reserve(children_.size());
+}
+
+bool MergingIterator::greater(size_t a, size_t b) const {
+    int c = children_[a]->key().compare(children_[b]->key());
+    if (c != 0) {
+        return c > 0;
+    }
+    // Equal keys: the lower index is newer and must surface first.
+    return a > b;
+}
+
+bool MergingIterator::childFailed(size_t idx) {
+    if (!children_[idx]->ok()) {
+        failed_ = true;
+    }
+    if (failed_) {
+        heap_.clear();
+    }
+    return failed_;
+}
+
+void MergingIterator::rebuildHeap() {
+    heap_.clear();
+    for (size_t i = 0; i < children_.size(); ++i) {
+        if (childFailed(i)) {
+            return;
+        }
+        if (children_[i]->valid()) {
+            heap_.push_back(i);
+        }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), [this](size_t a, size_t b) {
+        return greater(a, b);
+    });
+}
+
+bool MergingIterator::valid() const {
+    return !heap_.empty();
+}
+
+void MergingIterator::seekToFirst() {
+    for (auto &child : children_) {
+        child->seekToFirst();
+    }
+    rebuildHeap();
+}
+
+void MergingIterator::seek(std::string_view target) {
+    for (auto &child : children_) {
+        child->seek(target);
+    }
+    rebuildHeap();
+}
+
+void MergingIterator::next() {
+    auto cmp = [this](size_t a, size_t b) { return greater(a, b); };
+    auto advance = [&](size_t idx) {
+        children_[idx]->next();
+        if (childFailed(idx)) {
+            return false;
+        }
+        if (children_[idx]->valid()) {
+            heap_.push_back(idx);
+            std::push_heap(heap_.begin(), heap_.end(), cmp);
+        }
+        return true;
+    };
+    // The current child leaves the heap and moves last, so its key stays
+    // valid, without a copy, while older versions of it are skipped.
+    std::pop_heap(heap_.begin(), heap_.end(), cmp);
+    size_t current = heap_.back();
+    heap_.pop_back();
+    std::string_view currentKey = children_[current]->key();
+    while (!heap_.empty() && children_[heap_.front()]->key() == currentKey) {
+        std::pop_heap(heap_.begin(), heap_.end(), cmp);
+        size_t idx = heap_.back();
+        heap_.pop_back();
+        if (!advance(idx)) {
+            return;
+        }
+    }
+    advance(current);
+}
+
+std::string_view MergingIterator::key() const {
+    return children_[heap_.front()]->key();
+}
+
+const DBEntry &MergingIterator::entry() const {
+    return children_[heap_.front()]->entry();
+}
+
+bool MergingIterator::ok() const {
+    return !failed_;
+}
+
+}  // namespace DB
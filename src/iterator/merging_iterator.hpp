@@ -0,0 +1,41 @@
+#ifndef MERGING_ITERATOR_HPP_
+#define MERGING_ITERATOR_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "kv_iterator.hpp"
+
+namespace DB {
+
+// K-way merge of sorted children using a min-heap. Children are given newest
+// first; when several hold the same key only the newest version is returned.
+// A failing child ends the merge: without it an older version or a deleted
+// key could surface.
+class MergingIterator : public KVIterator {
+public:
+    explicit MergingIterator(std::vector<std::unique_ptr<KVIterator>> children);
+
+    bool valid() const override;
+    void seekToFirst() override;
+    void seek(std::string_view target) override;
+    void next() override;
+    std::string_view key() const override;
+    const DBEntry &entry() const override;
+    bool ok() const override;
+
+private:
+    std::vector<std::unique_ptr<KVIterator>> children_;
+    // Heap of child indices ordered by (key, age); front() is the current one.
+    std::vector<size_t> heap_;
+    bool failed_ = false;
+
+    // Records a failure of child `idx`, if any; true if the merge must stop.
+    bool childFailed(size_t idx);
+    bool greater(size_t a, size_t b) const;
+    void rebuildHeap();
+};
+
+}  // namespace DB
+
+#endif  // MERGING_ITERATOR_HPP_
@@ -0,0 +1,171 @@
+#include "merging_iterator.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+struct Row {
+    std::string key;
+    std::string value;
+    bool tombstone = false;
+};
+
+// Sorted rows served the way an SSTable iterator serves them: the current
+// key and entry are copied into buffers that every move overwrites.
+class RowIterator : public KVIterator {
+public:
+    explicit RowIterator(std::vector<Row> rows, size_t failAt = SIZE_MAX)
+        : rows_(std::move(rows)), failAt_(failAt) {
+    }
+
+    bool valid() const override {
+        return pos_ < rows_.size();
+    }
+
+    void seekToFirst() override {
+        moveTo(0);
+    }
+
+    void seek(std::string_view target) override {
+        size_t i = 0;
+        while (i < rows_.size() && rows_[i].key < target) {
+            ++i;
+        }
+        moveTo(i);
+    }
+
+    void next() override {
+        moveTo(pos_ + 1);
+    }
+
+    std::string_view key() const override {
+        return key_;
+    }
+
+    const DBEntry &entry() const override {
+        return entry_;
+    }
+
+    bool ok() const override {
+        return !failed_;
+    }
+
+private:
+    std::vector<Row> rows_;
+    size_t failAt_;
+    size_t pos_ = SIZE_MAX;
+    bool failed_ = false;
+    std::string key_;
+    DBEntry entry_;
+
+    void moveTo(size_t pos) {
+        pos_ = pos;
+        key_.clear();
+        if (pos_ >= failAt_) {
+            failed_ = true;
+            pos_ = rows_.size();
+        }
+        if (!valid()) {
+            return;
+        }
+        const auto &row = rows_[pos_];
+        key_ = row.key;
+        entry_ = DBEntry{{row.value.begin(), row.value.end()}, row.tombstone};
+    }
+};
+
+std::vector<std::unique_ptr<KVIterator>> children(
+    std::vector<std::vector<Row>> sources
+) {
+    std::vector<std::unique_ptr<KVIterator>> result;
+    for (auto &rows : sources) {
+        result.push_back(std::make_unique<RowIterator>(std::move(rows)));
+    }
+    return result;
+}
+
+std::vector<Row> drain(MergingIterator &it) {
+    std::vector<Row> rows;
+    for (; it.valid(); it.next()) {
+        const auto &e = it.entry();
+        rows.push_back(
+            {std::string(it.key()), std::string(e.value.begin(), e.value.end()),
+             e.tombstone}
+        );
+    }
+    return rows;
+}
+
+bool operator==(const Row &a, const Row &b) {
+    return a.key == b.key && a.value == b.value && a.tombstone == b.tombstone;
+}
+
+}  // namespace
+
+TEST(MergingIterator, NewestVersionWins) {
+    MergingIterator it(children({
+        {{"b", "new"}, {"d", "", true}},
+        {{"a", "mid"}, {"b", "mid"}, {"d", "mid"}},
+        {{"a", "old"}, {"b", "old"}, {"c", "old"}, {"d", "old"}},
+    }));
+    it.seekToFirst();
+    std::vector<Row> expected = {
+        {"a", "mid"}, {"b", "new"}, {"c", "old"}, {"d", "", true}};
+    EXPECT_EQ(drain(it), expected);
+    EXPECT_TRUE(it.ok());
+}
+
+TEST(MergingIterator, SkipsEveryShadowedCopyOfARun) {
+    // Each key is in every child, and children overwrite their key buffer
+    // when they move, so skipping must not read a moved child's old key.
+    std::vector<std::vector<Row>> sources(4);
+    for (size_t c = 0; c < sources.size(); ++c) {
+        for (char k = 'a'; k <= 'z'; ++k) {
+            sources[c].push_back({std::string(3, k), std::to_string(c)});
+        }
+    }
+    MergingIterator it(children(std::move(sources)));
+    it.seekToFirst();
+    auto rows = drain(it);
+    ASSERT_EQ(rows.size(), 26u);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        EXPECT_EQ(rows[i].key, std::string(3, static_cast<char>('a' + i)));
+        EXPECT_EQ(rows[i].value, "0");
+    }
+}
+
+TEST(MergingIterator, SeeksInEveryChild) {
+    MergingIterator it(children({
+        {{"b", "1"}, {"e", "1"}},
+        {{"a", "2"}, {"c", "2"}, {"e", "2"}},
+    }));
+    it.seek("bb");
+    std::vector<Row> expected = {{"c", "2"}, {"e", "1"}};
+    EXPECT_EQ(drain(it), expected);
+    it.seek("f");
+    EXPECT_FALSE(it.valid());
+}
+
+TEST(MergingIterator, FailingChildEndsTheMerge) {
+    std::vector<std::unique_ptr<KVIterator>> sources;
+    sources.push_back(std::make_unique<RowIterator>(
+        std::vector<Row>{{"a", "1"}, {"c", "1"}}
+    ));
+    // Fails when it moves past "b", which may be hiding an older "c".
+    sources.push_back(std::make_unique<RowIterator>(
+        std::vector<Row>{{"b", "2"}, {"c", "2"}}, 1
+    ));
+    MergingIterator it(std::move(sources));
+    it.seekToFirst();
+    std::vector<Row> expected = {{"a", "1"}, {"b", "2"}};
+    EXPECT_EQ(drain(it), expected);
+    EXPECT_FALSE(it.ok());
+}
+
+}  // namespace DB
@@ -7,7 +7,10 @@
 #include <userver/server/handlers/tests_control.hpp>
 #include <userver/testsuite/testsuite_support.hpp>
 #include <userver/utils/daemon_run.hpp>
+#include "components/database_component.hpp"
 #include "handlers/db_handler.hpp"
+#include "handlers/scan_handler.hpp"
+#include "handlers/stats_handler.hpp"
 
 int main(int argc, char *argv[]) {
     auto component_list =
@@ -20,8 +23,11 @@ int main(int argc, char *argv[]) {
             .Append<userver::components::TestsuiteSupport>()
             .Append<userver::server::handlers::TestsControl>();
 
+    component_list.Append<userver_db::DatabaseComponent>();
     component_list.Append<userver_db::DatabaseHandler>();
+    component_list.Append<userver_db::ScanHandler>();
     component_list.Append<userver_db::SnapshotHandler>();
+    component_list.Append<userver_db::StatsHandler>();
 
     return userver::utils::DaemonMain(argc, argv, component_list);
 }
@@ -0,0 +1,155 @@
+#include "manifest.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace DB {
+
+namespace {
+
+constexpr const char *kHeader = "clarity-manifest 1";
+
+// Keys are arbitrary bytes; hex keeps every line a list of plain tokens.
+// An empty key is written as "-".
+std::string toHex(const std::string &key) {
+    if (key.empty()) {
+        return "-";
+    }
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(key.size() * 2);
+    for (unsigned char c : key) {
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 0xf]);
+    }
+    return out;
+}
+
+bool fromHex(const std::string &hex, std::string &key) {
+    key.clear();
+    if (hex == "-") {
+        return true;
+    }
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        int hi = nibble(hex[i]), lo = nibble(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        key.push_back(static_cast<char>(hi << 4 | lo));
+    }
+    return true;
+}
+
+void writeAll(int fd, const std::string &data, const std::string &path) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(
+                "Cannot write " + path + ": " + std::strerror(errno)
+            );
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+}  // namespace
+
+Manifest::Manifest(std::string directory) : directory_(std::move(directory)) {
+}
+
+std::optional<std::vector<TableMeta>> Manifest::load() const {
+    std::string path = directory_ + "/MANIFEST";
+    std::ifstream in(path);
+    if (!in) {
+        return std::nullopt;
+    }
+    std::string line;
+    if (!std::getline(in, line) || line != kHeader) {
+        throw std::runtime_error("Unrecognized manifest " + path);
+    }
+    std::vector<TableMeta> tables;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        TableMeta meta;
+        std::string smallest, largest, extra;
+        if (!(fields >> meta.level >> meta.file >> meta.fileSize >> smallest >>
+              largest) ||
+            fields >> extra || meta.level < 0 ||
+            !fromHex(smallest, meta.smallestKey) ||
+            !fromHex(largest, meta.largestKey)) {
+            throw std::runtime_error("Corrupt manifest entry: " + line);
+        }
+        tables.push_back(std::move(meta));
+    }
+    return tables;
+}
+
+void Manifest::save(const std::vector<TableMeta> &tables) const {
+    std::string contents = std::string(kHeader) + "\n";
+    for (const auto &t : tables) {
+        contents += std::to_string(t.level) + " " + t.file + " " +
+                    std::to_string(t.fileSize) + " " + toHex(t.smallestKey) +
+                    " " + toHex(t.largestKey) + "\n";
+    }
+
+    std::string tmpPath = directory_ + "/MANIFEST.tmp";
+    std::string path = directory_ + "/MANIFEST";
+    int fd = ::open(
+        tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644
+    );
+    if (fd < 0) {
+        throw std::runtime_error(
+            "Cannot create " + tmpPath + ": " + std::strerror(errno)
+        );
+    }
+    try {
+        writeAll(fd, contents, tmpPath);
+        if (::fsync(fd) != 0) {
+            throw std::runtime_error(
+                "Cannot sync " + tmpPath + ": " + std::strerror(errno)
+            );
+        }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(tmpPath.c_str());
+        throw;
+    }
+    ::close(fd);
+    if (::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ::unlink(tmpPath.c_str());
+        throw std::runtime_error(
+            "Cannot install " + path + ": " + std::strerror(errno)
+        );
+    }
+    int dirFd = ::open(directory_.c_str(), O_RDONLY | O_DIRECTORY);
+    bool synced = dirFd >= 0 && ::fsync(dirFd) == 0;
+    if (dirFd >= 0) {
+        ::close(dirFd);
+    }
+    if (!synced) {
+        throw std::runtime_error("Cannot sync directory " + directory_);
+    }
+}
+
+}  // namespace DB
@@ -0,0 +1,45 @@
+#ifndef MANIFEST_HPP_
+#define MANIFEST_HPP_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace DB {
+
+// What the manifest records about one SSTable.
+struct TableMeta {
+    int level = 0;
+    // File name inside the database directory.
+    std::string file;
+    uint64_t fileSize = 0;
+    std::string smallestKey;
+    std::string largestKey;
+};
+
+// The MANIFEST file lists every live SSTable with its level and key range,
+// in read order: level 0 oldest first, deeper levels by key. Tables in the
+// directory that it does not list are leftovers of interrupted work.
+//
+// It is rewritten as a whole on every change: the new contents go to
+// MANIFEST.tmp, are fsynced and renamed over the old file, so a crash
+// leaves either the old or the new version.
+class Manifest {
+public:
+    explicit Manifest(std::string directory);
+
+    // Tables in file order, or nullopt if there is no manifest yet. Throws
+    // std::runtime_error on a malformed file.
+    std::optional<std::vector<TableMeta>> load() const;
+    // Throws std::runtime_error if the new version could not be made
+    // durable; the previous one is then still in place.
+    void save(const std::vector<TableMeta> &tables) const;
+
+private:
+    std::string directory_;
+};
+
+}  // namespace DB
+
+#endif  // MANIFEST_HPP_
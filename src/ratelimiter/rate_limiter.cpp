@@ -0,0 +1,108 @@
+#include "rate_limiter.hpp"
+#include <algorithm>
+#include <userver/engine/sleep.hpp>
+
+namespace DB {
+
+namespace {
+
+// Share of the per-second budget the bucket may hold.
+constexpr double kBurstSeconds = 0.1;
+
+}  // namespace
+
+RateLimiter::RateLimiter(
+    uint64_t bytesPerSecond,
+    uint64_t minBytesPerSecond,
+    uint64_t maxBytesPerSecond,
+    std::chrono::microseconds latencyTarget,
+    std::chrono::milliseconds tuneInterval
+)
+    : minRate_(std::min(minBytesPerSecond, bytesPerSecond)),
+      maxRate_(std::max(maxBytesPerSecond, bytesPerSecond)),
+      latencyTargetNs_(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(latencyTarget)
+              .count()
+      ),
+      tuneInterval_(tuneInterval),
+      rate_(bytesPerSecond),
+      refilled_(Clock::now()),
+      tuned_(refilled_) {
+    available_ = rate_ * kBurstSeconds;
+}
+
+void RateLimiter::refill(Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - refilled_).count();
+    refilled_ = now;
+    available_ = std::min(
+        available_ + elapsed * static_cast<double>(rate_),
+        rate_ * kBurstSeconds
+    );
+}
+
+void RateLimiter::tune(Clock::time_point now) {
+    if (now - tuned_ < tuneInterval_)
+        return;
+    tuned_ = now;
+    // Without foreground traffic there is nothing to protect.
+    bool idle = samples_.exchange(0, std::memory_order_relaxed) == 0;
+    int64_t latency = latencyNs_.load(std::memory_order_relaxed);
+    if (!idle && latency > latencyTargetNs_) {
+        rate_ = std::max(minRate_, rate_ / 4 * 3);
+    } else if (idle || latency < latencyTargetNs_ / 2) {
+        rate_ = std::min(maxRate_, rate_ + rate_ / 4);
+    }
+}
+
+void RateLimiter::request(uint64_t bytes) {
+    bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    std::chrono::nanoseconds wait{0};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (rate_ == 0)
+            return;
+        auto now = Clock::now();
+        tune(now);
+        refill(now);
+        available_ -= static_cast<double>(bytes);
+        if (available_ < 0) {
+            wait = std::chrono::nanoseconds(
+                static_cast<int64_t>(-available_ * 1e9 / rate_)
+            );
+        }
+    }
+    if (wait.count() > 0) {
+        throttledRequests_.fetch_add(1, std::memory_order_relaxed);
+        throttledNs_.fetch_add(wait.count(), std::memory_order_relaxed);
+        userver::engine::SleepFor(wait);
+    }
+}
+
+void RateLimiter::recordForegroundLatency(std::chrono::microseconds latency) {
+    int64_t sample =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    int64_t prev = latencyNs_.load(std::memory_order_relaxed);
+    latencyNs_.store(prev + (sample - prev) / 16, std::memory_order_relaxed);
+    samples_.fetch_add(1, std::memory_order_relaxed);
+}
+
+RateLimiter::Stats RateLimiter::stats() const {
+    Stats s;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.bytesPerSecond = rate_;
+    }
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.throttledRequests = throttledRequests_.load(std::memory_order_relaxed);
+    s.throttledTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds(
+            throttledNs_.load(std::memory_order_relaxed)
+        )
+    );
+    s.foregroundLatency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::nanoseconds(latencyNs_.load(std::memory_order_relaxed))
+    );
+    return s;
+}
+
+}  // namespace DB
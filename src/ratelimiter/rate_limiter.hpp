@@ -0,0 +1,82 @@
+#ifndef RATE_LIMITER_HPP_
+#define RATE_LIMITER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include "../configs/db_config.hpp"
+
+namespace DB {
+
+// Token bucket that paces background I/O (flush and compaction reads and
+// writes) so it does not crowd out foreground lookups on the same disk.
+//
+// Callers reserve bytes before each transfer and sleep until the bucket
+// covers them; the bucket holds at most 100 ms of budget, so idle periods do
+// not turn into bursts. The budget tunes itself between a floor and a
+// ceiling: it shrinks while the EWMA of foreground latency stays above the
+// target and grows back while it is well below it.
+class RateLimiter {
+public:
+    struct Stats {
+        uint64_t bytesPerSecond = 0;
+        uint64_t bytes = 0;
+        uint64_t throttledRequests = 0;
+        std::chrono::microseconds throttledTime{0};
+        std::chrono::microseconds foregroundLatency{0};
+    };
+
+    // A zero `bytesPerSecond` disables limiting; latencies are still
+    // tracked. The rate is retuned at most once per `tuneInterval`.
+    RateLimiter(
+        uint64_t bytesPerSecond,
+        uint64_t minBytesPerSecond,
+        uint64_t maxBytesPerSecond,
+        std::chrono::microseconds latencyTarget,
+        std::chrono::milliseconds tuneInterval =
+            DBConfig::kRateLimiterTuneInterval
+    );
+    RateLimiter(const RateLimiter &) = delete;
+    RateLimiter &operator=(const RateLimiter &) = delete;
+
+    // Waits until `bytes` of background I/O may proceed. Must be called
+    // from a coroutine; the wait is a cancellable engine sleep.
+    void request(uint64_t bytes);
+    // Latency of one foreground operation. Lock-free.
+    void recordForegroundLatency(std::chrono::microseconds latency);
+
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const uint64_t minRate_;
+    const uint64_t maxRate_;
+    const int64_t latencyTargetNs_;
+    const std::chrono::milliseconds tuneInterval_;
+
+    mutable std::mutex mutex_;
+    // Guarded by mutex_. May go negative: a request larger than the bucket
+    // reserves future budget and later callers wait for it.
+    double available_ = 0;
+    uint64_t rate_;
+    Clock::time_point refilled_;
+    Clock::time_point tuned_;
+
+    // Fixed-point EWMA of foreground latency in nanoseconds; concurrent
+    // updates may be lost, which only makes it slightly less smooth.
+    std::atomic<int64_t> latencyNs_{0};
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> throttledRequests_{0};
+    std::atomic<int64_t> throttledNs_{0};
+
+    // These require mutex_ to be held.
+    void refill(Clock::time_point now);
+    void tune(Clock::time_point now);
+};
+
+}  // namespace DB
+
+#endif  // RATE_LIMITER_HPP_
@@ -0,0 +1,132 @@
+#include "rate_limiter.hpp"
+#include <chrono>
+#include <userver/engine/sleep.hpp>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+
+constexpr uint64_t kMiB = 1 << 20;
+constexpr microseconds kTarget{1000};
+constexpr milliseconds kTuneInterval{10};
+
+// Lets a tuning interval pass and triggers the retune with a tiny request.
+void nextTuneTick(RateLimiter &limiter) {
+    userver::engine::SleepFor(kTuneInterval * 2);
+    limiter.request(1);
+}
+
+}  // namespace
+
+UTEST(RateLimiter, BurstIsNotThrottled) {
+    RateLimiter limiter(10 * kMiB, kMiB, 100 * kMiB, kTarget);
+    // The bucket starts full with a tenth of a second's budget.
+    limiter.request(kMiB);
+    auto stats = limiter.stats();
+    EXPECT_EQ(stats.throttledRequests, 0u);
+    EXPECT_EQ(stats.bytes, kMiB);
+}
+
+UTEST(RateLimiter, PacesRequestsToTheRate) {
+    RateLimiter limiter(10 * kMiB, kMiB, 100 * kMiB, kTarget);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 40; ++i) {
+        limiter.request(kMiB / 8);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // 5 MiB at 10 MiB/s, less the initial burst of 1 MiB.
+    EXPECT_GE(elapsed, milliseconds(350));
+    EXPECT_LT(elapsed, milliseconds(1000));
+    auto stats = limiter.stats();
+    EXPECT_GT(stats.throttledRequests, 0u);
+    EXPECT_GE(stats.throttledTime, milliseconds(350));
+}
+
+UTEST(RateLimiter, RefillsWhileIdle) {
+    RateLimiter limiter(10 * kMiB, kMiB, 100 * kMiB, kTarget);
+    limiter.request(kMiB);
+    // 60 ms at 10 MiB/s brings back more than half a MiB.
+    userver::engine::SleepFor(milliseconds(60));
+    limiter.request(kMiB / 2);
+    EXPECT_EQ(limiter.stats().throttledRequests, 0u);
+}
+
+UTEST(RateLimiter, RefillIsCappedAtTheBurst) {
+    RateLimiter limiter(10 * kMiB, kMiB, 100 * kMiB, kTarget);
+    userver::engine::SleepFor(milliseconds(200));
+    // An idle period does not save up more than the burst.
+    limiter.request(2 * kMiB);
+    EXPECT_EQ(limiter.stats().throttledRequests, 1u);
+}
+
+UTEST(RateLimiter, ZeroRateDisablesLimiting) {
+    RateLimiter limiter(0, 0, 0, kTarget);
+    auto start = std::chrono::steady_clock::now();
+    limiter.request(1024 * kMiB);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, milliseconds(100));
+    auto stats = limiter.stats();
+    EXPECT_EQ(stats.bytesPerSecond, 0u);
+    EXPECT_EQ(stats.bytes, 1024 * kMiB);
+    EXPECT_EQ(stats.throttledRequests, 0u);
+}
+
+UTEST(RateLimiter, SlowsDownUnderLatencyPressure) {
+    RateLimiter limiter(16 * kMiB, 4 * kMiB, 64 * kMiB, kTarget, kTuneInterval);
+    for (int i = 0; i < 100; ++i) {
+        limiter.recordForegroundLatency(kTarget * 10);
+    }
+    nextTuneTick(limiter);
+    EXPECT_EQ(limiter.stats().bytesPerSecond, 12 * kMiB);
+
+    for (int round = 0; round < 10; ++round) {
+        limiter.recordForegroundLatency(kTarget * 10);
+        nextTuneTick(limiter);
+    }
+    EXPECT_EQ(limiter.stats().bytesPerSecond, 4 * kMiB);
+}
+
+UTEST(RateLimiter, SpeedsUpWhenIdle) {
+    RateLimiter limiter(16 * kMiB, 4 * kMiB, 64 * kMiB, kTarget, kTuneInterval);
+    // No foreground samples at all.
+    nextTuneTick(limiter);
+    EXPECT_EQ(limiter.stats().bytesPerSecond, 20 * kMiB);
+
+    for (int round = 0; round < 10; ++round) {
+        nextTuneTick(limiter);
+    }
+    EXPECT_EQ(limiter.stats().bytesPerSecond, 64 * kMiB);
+}
+
+UTEST(RateLimiter, SpeedsUpUnderLowLatency) {
+    RateLimiter limiter(16 * kMiB, 4 * kMiB, 64 * kMiB, kTarget, kTuneInterval);
+    limiter.recordForegroundLatency(kTarget / 4);
+    nextTuneTick(limiter);
+    EXPECT_EQ(limiter.stats().bytesPerSecond, 20 * kMiB);
+}
+
+UTEST(RateLimiter, HoldsNearTheTarget) {
+    RateLimiter limiter(16 * kMiB, 4 * kMiB, 64 * kMiB, kTarget, kTuneInterval);
+    // Converge the average between half the target and the target.
+    for (int i = 0; i < 200; ++i) {
+        limiter.recordForegroundLatency(kTarget * 3 / 4);
+    }
+    nextTuneTick(limiter);
+    EXPECT_EQ(limiter.stats().bytesPerSecond, 16 * kMiB);
+    EXPECT_GT(limiter.stats().foregroundLatency, kTarget / 2);
+    EXPECT_LT(limiter.stats().foregroundLatency, kTarget);
+}
+
+UTEST(RateLimiter, DoesNotTuneBeforeTheInterval) {
+    RateLimiter limiter(
+        16 * kMiB, 4 * kMiB, 64 * kMiB, kTarget, milliseconds(60000)
+    );
+    limiter.recordForegroundLatency(kTarget * 10);
+    limiter.request(1);
+    EXPECT_EQ(limiter.stats().bytesPerSecond, 16 * kMiB);
+}
+
+}  // namespace DB
@@ -0,0 +1,71 @@
+#ifndef ARENA_HPP_
+#define ARENA_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator: memory is carved out of large blocks and released all at
+// once by reset() or the destructor. Individual allocations are never freed.
+class Arena {
+public:
+    static constexpr std::size_t kBlockSize = 64 * 1024;
+
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+        assert(align && (align & (align - 1)) == 0);
+        std::uintptr_t p = reinterpret_cast<std::uintptr_t>(ptr_);
+        std::size_t pad = (align - (p & (align - 1))) & (align - 1);
+        if (ptr_ && pad + bytes <= remaining_) {
+            char *result = ptr_ + pad;
+            ptr_ = result + bytes;
+            remaining_ -= pad + bytes;
+            return result;
+        }
+        return allocateFallback(bytes, align);
+    }
+
+    void reset() noexcept {
+        blocks_.clear();
+        ptr_ = nullptr;
+        remaining_ = 0;
+        memoryUsage_ = 0;
+    }
+
+    // Bytes reserved from the system, including unused block tails.
+    std::size_t memoryUsage() const noexcept {
+        return memoryUsage_;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char *ptr_ = nullptr;
+    std::size_t remaining_ = 0;
+    std::size_t memoryUsage_ = 0;
+
+    char *newBlock(std::size_t bytes) {
+        blocks_.emplace_back(new char[bytes]);
+        memoryUsage_ += bytes;
+        return blocks_.back().get();
+    }
+
+    void *allocateFallback(std::size_t bytes, std::size_t align) {
+        // Large objects get a dedicated block so the current one is not
+        // abandoned with most of its space unused.
+        if (bytes + align > kBlockSize / 4) {
+            char *block = newBlock(bytes + align);
+            std::uintptr_t p = reinterpret_cast<std::uintptr_t>(block);
+            return block + ((align - (p & (align - 1))) & (align - 1));
+        }
+        ptr_ = newBlock(kBlockSize);
+        remaining_ = kBlockSize;
+        return allocate(bytes, align);
+    }
+};
+
+#endif  // ARENA_HPP_
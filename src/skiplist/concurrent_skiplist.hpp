@@ -0,0 +1,258 @@
+#ifndef CONCURRENT_SKIPLIST_HPP_
+#define CONCURRENT_SKIPLIST_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include "arena.hpp"
+#include "heap_bytes.hpp"
+
+// Skip list for a single writer and any number of concurrent readers.
+//
+// Writers must be serialized externally. Readers take no locks: nodes are
+// published with release stores on the forward pointers and read with acquire
+// loads. Nothing is unlinked or freed while the map is alive; overwriting a key
+// publishes a new value cell and keeps the old one reachable through `prev`,
+// so a reader never observes a destroyed value. All memory is reclaimed at
+// once when the map is destroyed, which callers defer until no reader holds a
+// reference (e.g. via shared_ptr).
+template <
+    typename Key,
+    typename Value,
+    typename Compare = std::less<>,
+    int MAX_LEVEL = 16>
+class ConcurrentSkipListMap {
+private:
+    static constexpr double probability = 0.5;
+
+    struct ValueCell {
+        Value value;
+        ValueCell *prev;
+
+        template <typename V>
+        ValueCell(V &&v, ValueCell *p) : value(std::forward<V>(v)), prev(p) {
+        }
+    };
+
+    struct Node {
+        Key key;
+        std::atomic<ValueCell *> cell;
+        std::atomic<Node *> forward[1];
+
+        template <typename K>
+        Node(K &&k, ValueCell *c) : key(std::forward<K>(k)), cell(c) {
+        }
+
+        Node *next(int i) const {
+            return forward[i].load(std::memory_order_acquire);
+        }
+    };
+
+    Arena arena_;
+    Node *head_;
+    std::atomic<int> level_;
+    std::atomic<size_t> size_;
+    std::atomic<size_t> heapBytes_;
+    Compare cmp_;
+    std::mt19937_64 rnd_;
+
+    template <typename K>
+    Node *newNode(int lvl, K &&k, ValueCell *c) {
+        size_t bytes = sizeof(Node) + sizeof(std::atomic<Node *>) * lvl;
+        void *mem = arena_.allocate(bytes, alignof(Node));
+        Node *n = new (mem) Node(std::forward<K>(k), c);
+        heapBytes_.fetch_add(heapBytes(n->key), std::memory_order_relaxed);
+        for (int i = 1; i <= lvl; ++i) {
+            new (&n->forward[i]) std::atomic<Node *>(nullptr);
+        }
+        n->forward[0].store(nullptr, std::memory_order_relaxed);
+        return n;
+    }
+
+    template <typename V>
+    ValueCell *newCell(V &&v, ValueCell *prev) {
+        void *mem = arena_.allocate(sizeof(ValueCell), alignof(ValueCell));
+        ValueCell *c = new (mem) ValueCell(std::forward<V>(v), prev);
+        heapBytes_.fetch_add(heapBytes(c->value), std::memory_order_relaxed);
+        return c;
+    }
+
+    int randomLevel() {
+        int lvl = 0;
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        while (lvl < MAX_LEVEL && dist(rnd_) < probability) {
+            ++lvl;
+        }
+        return lvl;
+    }
+
+    // Last node whose key is less than `key` on every level; fills `update`
+    // when it is provided.
+    template <typename K>
+    Node *findLess(const K &key, Node **update) const {
+        Node *x = head_;
+        for (int i = level_.load(std::memory_order_relaxed); i >= 0; --i) {
+            Node *next = x->next(i);
+            while (next && cmp_(next->key, key)) {
+                x = next;
+                next = x->next(i);
+            }
+            if (update) {
+                update[i] = x;
+            }
+        }
+        return x;
+    }
+
+public:
+    ConcurrentSkipListMap()
+        : head_(nullptr),
+          level_(0),
+          size_(0),
+          heapBytes_(0),
+          rnd_(std::random_device{}()) {
+        head_ = newNode(MAX_LEVEL, Key(), nullptr);
+    }
+
+    ConcurrentSkipListMap(const ConcurrentSkipListMap &) = delete;
+    ConcurrentSkipListMap &operator=(const ConcurrentSkipListMap &) = delete;
+
+    ~ConcurrentSkipListMap() {
+        Node *cur = head_->next(0);
+        while (cur) {
+            Node *next = cur->next(0);
+            ValueCell *c = cur->cell.load(std::memory_order_relaxed);
+            while (c) {
+                ValueCell *prev = c->prev;
+                c->~ValueCell();
+                c = prev;
+            }
+            cur->~Node();
+            cur = next;
+        }
+        head_->~Node();
+    }
+
+    size_t size() const noexcept {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // Approximate bytes held by the node arena.
+    size_t arenaMemoryUsage() const noexcept {
+        return arena_.memoryUsage();
+    }
+
+    // Arena plus heap memory owned by keys and values, including values that
+    // were overwritten but are kept alive for concurrent readers.
+    size_t approximateMemoryUsage() const noexcept {
+        return arena_.memoryUsage() +
+               heapBytes_.load(std::memory_order_relaxed);
+    }
+
+    // Writer side. Must not be called concurrently with another insert.
+    // Key and value are moved in when passed as rvalues.
+    template <typename K, typename V>
+    void insert_or_assign(K &&key, V &&val) {
+        Node *update[MAX_LEVEL + 1];
+        Node *x = findLess(key, update)->next(0);
+        if (x && !cmp_(key, x->key)) {
+            ValueCell *old = x->cell.load(std::memory_order_relaxed);
+            x->cell.store(
+                newCell(std::forward<V>(val), old), std::memory_order_release
+            );
+            return;
+        }
+        int lvl = randomLevel();
+        int cur = level_.load(std::memory_order_relaxed);
+        if (lvl > cur) {
+            for (int i = cur + 1; i <= lvl; ++i) {
+                update[i] = head_;
+            }
+            // Readers that see the new level before the node is linked just
+            // find nullptr at the head and drop down a level.
+            level_.store(lvl, std::memory_order_relaxed);
+        }
+        Node *n = newNode(
+            lvl, std::forward<K>(key), newCell(std::forward<V>(val), nullptr)
+        );
+        for (int i = 0; i <= lvl; ++i) {
+            n->forward[i].store(
+                update[i]->forward[i].load(std::memory_order_relaxed),
+                std::memory_order_relaxed
+            );
+            update[i]->forward[i].store(n, std::memory_order_release);
+        }
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void insert(const Key &key, const Value &val) {
+        insert_or_assign(key, val);
+    }
+
+    // Reader side. The returned pointer stays valid for the lifetime of the
+    // map, even if the key is overwritten afterwards. Accepts any type the
+    // comparator can order against Key, e.g. std::string_view.
+    template <typename K>
+    const Value *find(const K &key) const {
+        Node *x = findLess(key, nullptr)->next(0);
+        if (x && !cmp_(key, x->key)) {
+            return &x->cell.load(std::memory_order_acquire)->value;
+        }
+        return nullptr;
+    }
+
+    class iterator {
+        const Node *n_;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<const Key &, const Value &>;
+        using reference = value_type;
+
+        explicit iterator(const Node *p) : n_(p) {
+        }
+
+        iterator &operator++() {
+            n_ = n_->next(0);
+            return *this;
+        }
+
+        reference operator*() const {
+            return {
+                n_->key, n_->cell.load(std::memory_order_acquire)->value};
+        }
+
+        bool operator==(iterator o) const {
+            return n_ == o.n_;
+        }
+
+        bool operator!=(iterator o) const {
+            return !(*this == o);
+        }
+    };
+
+    iterator begin() const {
+        return iterator(head_->next(0));
+    }
+
+    iterator end() const {
+        return iterator(nullptr);
+    }
+
+    // First element whose key is not less than `key`.
+    template <typename K>
+    iterator lower_bound(const K &key) const {
+        return iterator(findLess(key, nullptr)->next(0));
+    }
+};
+
+#endif  // CONCURRENT_SKIPLIST_HPP_
@@ -0,0 +1,152 @@
+#include "concurrent_skiplist.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <userver/utest/utest.hpp>
+
+namespace {
+
+using Map = ConcurrentSkipListMap<std::string, std::string>;
+
+constexpr int kKeys = 2000;
+constexpr int kVersions = 4;
+
+std::string key(int i) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "key%05d", i);
+    return buf;
+}
+
+// Long enough to live on the heap, with a length that changes between
+// versions, so a torn read shows up as a mismatch.
+std::string value(const std::string &key, int version) {
+    return key + "/" + std::to_string(version) + "/" +
+           std::string(32 + 16 * version, static_cast<char>('a' + version));
+}
+
+// Whether `v` is some version of the value written for `key`.
+bool isValueOf(const std::string &key, const std::string &v) {
+    for (int version = 0; version < kVersions; ++version) {
+        if (v == value(key, version)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+TEST(ConcurrentSkipList, FindsAndOrdersKeys) {
+    Map map;
+    for (int i : {3, 1, 2}) {
+        map.insert_or_assign(key(i), value(key(i), 0));
+    }
+    map.insert_or_assign(key(2), value(key(2), 1));
+    EXPECT_EQ(map.size(), 3u);
+    EXPECT_EQ(*map.find(key(2)), value(key(2), 1));
+    EXPECT_EQ(map.find(key(4)), nullptr);
+    EXPECT_EQ(map.find(std::string_view("key00001")), map.find(key(1)));
+
+    std::vector<std::string> keys;
+    for (const auto &kv : map) {
+        keys.push_back(kv.first);
+    }
+    EXPECT_EQ(keys, (std::vector<std::string>{key(1), key(2), key(3)}));
+    EXPECT_EQ((*map.lower_bound(std::string_view("key00001x"))).first, key(2));
+    EXPECT_EQ(map.lower_bound(key(4)), map.end());
+}
+
+TEST(ConcurrentSkipList, OverwriteKeepsOldValueForReaders) {
+    Map map;
+    map.insert_or_assign(key(1), value(key(1), 0));
+    const std::string *held = map.find(key(1));
+    const std::string &iterated = (*map.begin()).second;
+    size_t before = map.approximateMemoryUsage();
+
+    for (int version = 1; version < kVersions; ++version) {
+        map.insert_or_assign(key(1), value(key(1), version));
+    }
+    // The cells read before the overwrites are still intact.
+    EXPECT_EQ(*held, value(key(1), 0));
+    EXPECT_EQ(iterated, value(key(1), 0));
+    EXPECT_EQ(*map.find(key(1)), value(key(1), kVersions - 1));
+    EXPECT_EQ(map.size(), 1u);
+    // Superseded values are still counted until the map goes away.
+    EXPECT_GT(map.approximateMemoryUsage(), before);
+}
+
+TEST(ConcurrentSkipList, ReadersSeeSortedCompleteEntriesDuringWrites) {
+    Map map;
+    std::vector<int> order(kKeys);
+    for (int i = 0; i < kKeys; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> violations{0};
+    auto reader = [&](int seed) {
+        std::mt19937 rnd(seed);
+        while (!done.load(std::memory_order_acquire)) {
+            // A full pass sees keys in order, each with a whole value.
+            std::string last;
+            size_t seen = 0;
+            for (const auto &kv : map) {
+                if (seen > 0 && !(last < kv.first)) {
+                    ++violations;
+                }
+                if (!isValueOf(kv.first, kv.second)) {
+                    ++violations;
+                }
+                last = kv.first;
+                ++seen;
+            }
+            if (seen > static_cast<size_t>(kKeys)) {
+                ++violations;
+            }
+            // A lower bound lands on the probe or past it; a value read
+            // through find stays valid across later overwrites.
+            auto probe = key(static_cast<int>(rnd() % kKeys)) + "~";
+            auto it = map.lower_bound(probe);
+            if (it != map.end() && !(probe < (*it).first)) {
+                ++violations;
+            }
+            auto k = key(static_cast<int>(rnd() % kKeys));
+            if (const std::string *v = map.find(k)) {
+                std::string copy = *v;
+                if (!isValueOf(k, copy) || *v != copy) {
+                    ++violations;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back(reader, i);
+    }
+
+    // The single writer inserts every key, then overwrites each of them.
+    for (int version = 0; version < kVersions; ++version) {
+        for (int i : order) {
+            map.insert_or_assign(key(i), value(key(i), version));
+        }
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &t : readers) {
+        t.join();
+    }
+
+    EXPECT_EQ(violations.load(), 0u);
+    EXPECT_EQ(map.size(), static_cast<size_t>(kKeys));
+    int i = 0;
+    for (const auto &kv : map) {
+        EXPECT_EQ(kv.first, key(i));
+        EXPECT_EQ(kv.second, value(key(i), kVersions - 1));
+        ++i;
+    }
+    EXPECT_EQ(i, kKeys);
+}
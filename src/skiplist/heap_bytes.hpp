@@ -0,0 +1,27 @@
+#ifndef HEAP_BYTES_HPP_
+#define HEAP_BYTES_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Heap memory owned by a value on top of sizeof(T), used to account for
+// memtable size. Types that own heap memory provide an overload found by
+// argument-dependent lookup.
+template <typename T>
+std::size_t heapBytes(const T &) {
+    return 0;
+}
+
+inline std::size_t heapBytes(const std::string &s) {
+    const char *self = reinterpret_cast<const char *>(&s);
+    bool inlineBuffer = s.data() >= self && s.data() < self + sizeof(s);
+    return inlineBuffer ? 0 : s.capacity() + 1;
+}
+
+template <typename T, typename A>
+std::size_t heapBytes(const std::vector<T, A> &v) {
+    return v.capacity() * sizeof(T);
+}
+
+#endif  // HEAP_BYTES_HPP_
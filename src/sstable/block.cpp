@@ -0,0 +1,178 @@
+#include "block.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace DB {
+
+namespace {
+
+void appendVarint(std::string &out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool readVarint(std::string_view data, size_t &pos, uint32_t &v) {
+    v = 0;
+    for (int shift = 0; shift <= 28 && pos < data.size(); shift += 7) {
+        uint32_t byte = static_cast<unsigned char>(data[pos++]);
+        v |= (byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void appendU32(std::string &out, uint32_t v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+uint32_t loadU32(const char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+}  // namespace
+
+BlockBuilder::BlockBuilder(size_t restartInterval)
+    : restartInterval_(std::max<size_t>(restartInterval, 1)) {
+}
+
+void BlockBuilder::add(std::string_view key, const DBEntry &entry) {
+    size_t shared = 0;
+    if (count_ > 0 && sinceRestart_ < restartInterval_) {
+        size_t limit = std::min(lastKey_.size(), key.size());
+        while (shared < limit && lastKey_[shared] == key[shared]) {
+            ++shared;
+        }
+    } else {
+        restarts_.push_back(static_cast<uint32_t>(buffer_.size()));
+        sinceRestart_ = 0;
+    }
+    appendVarint(buffer_, static_cast<uint32_t>(shared));
+    appendVarint(buffer_, static_cast<uint32_t>(key.size() - shared));
+    appendVarint(buffer_, static_cast<uint32_t>(entry.value.size()));
+    buffer_.push_back(entry.tombstone ? 1 : 0);
+    buffer_.append(key.data() + shared, key.size() - shared);
+    buffer_.append(
+        reinterpret_cast<const char *>(entry.value.data()), entry.value.size()
+    );
+    lastKey_.assign(key.data(), key.size());
+    ++count_;
+    ++sinceRestart_;
+}
+
+const std::string &BlockBuilder::finish() {
+    for (uint32_t offset : restarts_) {
+        appendU32(buffer_, offset);
+    }
+    appendU32(buffer_, static_cast<uint32_t>(restarts_.size()));
+    return buffer_;
+}
+
+void BlockBuilder::reset() {
+    buffer_.clear();
+    restarts_.clear();
+    lastKey_.clear();
+    count_ = 0;
+    sinceRestart_ = 0;
+}
+
+BlockIterator::BlockIterator(std::string_view block) {
+    if (block.size() < sizeof(uint32_t)) {
+        corrupt_ = true;
+        return;
+    }
+    uint32_t n = loadU32(block.data() + block.size() - sizeof(uint32_t));
+    if (n == 0 || n > block.size() / sizeof(uint32_t) - 1) {
+        corrupt_ = true;
+        return;
+    }
+    size_t restartsStart = block.size() - (n + 1) * sizeof(uint32_t);
+    data_ = block.substr(0, restartsStart);
+    restarts_ = block.data() + restartsStart;
+    numRestarts_ = n;
+}
+
+uint32_t BlockIterator::restartOffset(uint32_t i) const {
+    return loadU32(restarts_ + i * sizeof(uint32_t));
+}
+
+void BlockIterator::seekToRestart(uint32_t i) {
+    key_.clear();
+    next_ = restartOffset(i);
+    parseNext();
+}
+
+void BlockIterator::seekToFirst() {
+    valid_ = false;
+    if (numRestarts_ > 0) {
+        seekToRestart(0);
+    }
+}
+
+void BlockIterator::seek(std::string_view target) {
+    valid_ = false;
+    if (numRestarts_ == 0) {
+        return;
+    }
+    // Last restart point whose key is less than the target; keys there are
+    // stored in full.
+    uint32_t lo = 0;
+    uint32_t hi = numRestarts_ - 1;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        seekToRestart(mid);
+        if (!valid_) {
+            return;
+        }
+        if (key_ < target) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    for (seekToRestart(lo); valid_ && key_ < target; parseNext()) {
+    }
+}
+
+void BlockIterator::next() {
+    parseNext();
+}
+
+void BlockIterator::copyEntry(DBEntry &entry) const {
+    entry.value.assign(value_.begin(), value_.end());
+    entry.tombstone = tombstone_;
+}
+
+void BlockIterator::parseNext() {
+    valid_ = false;
+    size_t pos = next_;
+    uint32_t shared = 0;
+    uint32_t unshared = 0;
+    uint32_t valueSize = 0;
+    if (pos == data_.size()) {
+        return;
+    }
+    if (pos > data_.size() || !readVarint(data_, pos, shared) ||
+        !readVarint(data_, pos, unshared) ||
+        !readVarint(data_, pos, valueSize) || shared > key_.size() ||
+        data_.size() - pos <
+            static_cast<size_t>(unshared) + valueSize + 1) {
+        corrupt_ = true;
+        return;
+    }
+    tombstone_ = data_[pos++] == 1;
+    key_.resize(shared);
+    key_.append(data_.data() + pos, unshared);
+    pos += unshared;
+    value_ = data_.substr(pos, valueSize);
+    next_ = pos + valueSize;
+    valid_ = true;
+}
+
+}  // namespace DB
@@ -0,0 +1,109 @@
+#ifndef BLOCK_HPP_
+#define BLOCK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../base/db_entry.hpp"
+
+namespace DB {
+
+// A data block is a run of records in key order followed by a restart
+// array:
+//
+//   record:  [shared:varint][unshared:varint][valueSize:varint]
+//            [tombstone:1][key bytes after the shared prefix][value]
+//   trailer: [restart offset:4]...[restart count:4]
+//
+// Each key stores only what differs from the previous key. Every
+// `restartInterval` records the prefix is reset (shared = 0) and the record
+// offset is added to the restart array, so a lookup can binary-search the
+// restart points and then decode at most one interval.
+
+// Accumulates records for one data block.
+class BlockBuilder {
+public:
+    explicit BlockBuilder(size_t restartInterval = 16);
+
+    void add(std::string_view key, const DBEntry &entry);
+
+    bool empty() const {
+        return count_ == 0;
+    }
+
+    // Size of the block if it were finished now.
+    size_t size() const {
+        return buffer_.size() + (restarts_.size() + 1) * sizeof(uint32_t);
+    }
+
+    // Appends the restart array and returns the finished block, which stays
+    // valid until reset().
+    const std::string &finish();
+    void reset();
+
+private:
+    size_t restartInterval_;
+    std::string buffer_;
+    std::vector<uint32_t> restarts_;
+    std::string lastKey_;
+    size_t count_ = 0;
+    size_t sinceRestart_ = 0;
+};
+
+// Walks the records of one block. Values are views into the block, which
+// must outlive the iterator; keys are rebuilt into an internal buffer. A
+// malformed record or restart array ends the iteration and sets corrupt().
+class BlockIterator {
+public:
+    BlockIterator() = default;
+    explicit BlockIterator(std::string_view block);
+
+    bool valid() const {
+        return valid_;
+    }
+
+    void seekToFirst();
+    // Positions at the first record whose key is not less than `target`.
+    void seek(std::string_view target);
+    void next();
+
+    std::string_view key() const {
+        return key_;
+    }
+
+    std::string_view value() const {
+        return value_;
+    }
+
+    bool tombstone() const {
+        return tombstone_;
+    }
+
+    bool corrupt() const {
+        return corrupt_;
+    }
+
+    void copyEntry(DBEntry &entry) const;
+
+private:
+    // Records only, without the restart array.
+    std::string_view data_;
+    const char *restarts_ = nullptr;
+    uint32_t numRestarts_ = 0;
+    size_t next_ = 0;
+    bool valid_ = false;
+    bool corrupt_ = false;
+    std::string key_;
+    std::string_view value_;
+    bool tombstone_ = false;
+
+    uint32_t restartOffset(uint32_t i) const;
+    void seekToRestart(uint32_t i);
+    void parseNext();
+};
+
+}  // namespace DB
+
+#endif  // BLOCK_HPP_
@@ -0,0 +1,96 @@
+#include "block_index.hpp"
+#include <cstring>
+
+namespace DB {
+
+namespace {
+
+template <typename T>
+void appendFixed(std::string &out, T v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+template <typename T>
+bool readFixed(std::string_view in, size_t &pos, T &v) {
+    if (in.size() - pos < sizeof(v)) {
+        return false;
+    }
+    std::memcpy(&v, in.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return true;
+}
+
+}  // namespace
+
+void BlockIndex::add(std::string_view lastKey, BlockHandle handle) {
+    entries_.push_back(Entry{
+        handle.offset, handle.size, static_cast<uint32_t>(keys_.size()),
+        static_cast<uint32_t>(lastKey.size())});
+    keys_.append(lastKey.data(), lastKey.size());
+}
+
+size_t BlockIndex::find(std::string_view key) const {
+    size_t lo = 0;
+    size_t hi = entries_.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lastKey(mid) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void BlockIndex::encodeTo(std::string &out) const {
+    appendFixed(out, static_cast<uint32_t>(firstKey_.size()));
+    out.append(firstKey_);
+    appendFixed(out, static_cast<uint32_t>(entries_.size()));
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        appendFixed(out, entries_[i].offset);
+        appendFixed(out, entries_[i].size);
+        appendFixed(out, entries_[i].keyLength);
+        auto key = lastKey(i);
+        out.append(key.data(), key.size());
+    }
+}
+
+bool BlockIndex::decodeFrom(std::string_view in) {
+    entries_.clear();
+    keys_.clear();
+    size_t pos = 0;
+    uint32_t firstKeyLength = 0;
+    if (!readFixed(in, pos, firstKeyLength) ||
+        in.size() - pos < firstKeyLength) {
+        return false;
+    }
+    firstKey_.assign(in.data() + pos, firstKeyLength);
+    pos += firstKeyLength;
+    uint32_t count = 0;
+    if (!readFixed(in, pos, count)) {
+        return false;
+    }
+    // Each entry takes at least 16 bytes, which bounds a corrupt count.
+    if (count > (in.size() - pos) / 16) {
+        return false;
+    }
+    entries_.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        BlockHandle handle;
+        uint32_t keyLength = 0;
+        if (!readFixed(in, pos, handle.offset) ||
+            !readFixed(in, pos, handle.size) ||
+            !readFixed(in, pos, keyLength) || in.size() - pos < keyLength) {
+            entries_.clear();
+            keys_.clear();
+            return false;
+        }
+        add(in.substr(pos, keyLength), handle);
+        pos += keyLength;
+    }
+    keys_.shrink_to_fit();
+    return true;
+}
+
+}  // namespace DB
@@ -0,0 +1,81 @@
+#ifndef BLOCK_INDEX_HPP_
+#define BLOCK_INDEX_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DB {
+
+// Location of a block inside a table file.
+struct BlockHandle {
+    uint64_t offset = 0;
+    uint32_t size = 0;
+};
+
+// Sparse index with one entry per data block, keyed by the block's last key.
+// Entries live in one contiguous array and their keys in one shared string,
+// so a table with millions of keys costs a few bytes per block here.
+class BlockIndex {
+public:
+    void add(std::string_view lastKey, BlockHandle handle);
+
+    // Smallest key in the table, i.e. the first key of the first block.
+    void setFirstKey(std::string_view key) {
+        firstKey_.assign(key.data(), key.size());
+    }
+
+    std::string_view firstKey() const {
+        return firstKey_;
+    }
+
+    size_t size() const {
+        return entries_.size();
+    }
+
+    bool empty() const {
+        return entries_.empty();
+    }
+
+    BlockHandle handle(size_t i) const {
+        return {entries_[i].offset, entries_[i].size};
+    }
+
+    std::string_view lastKey(size_t i) const {
+        return std::string_view(keys_).substr(
+            entries_[i].keyOffset, entries_[i].keyLength
+        );
+    }
+
+    // The only block that can hold `key`: the first one whose last key is
+    // not less than it. size() if `key` is past the end of the table.
+    size_t find(std::string_view key) const;
+
+    // [firstKeyLength:4][firstKey][count:4] then per block
+    // [offset:8][size:4][keyLength:4][key].
+    void encodeTo(std::string &out) const;
+    bool decodeFrom(std::string_view in);
+
+    size_t memoryUsage() const {
+        return entries_.capacity() * sizeof(Entry) + keys_.capacity() +
+               firstKey_.capacity();
+    }
+
+private:
+    struct Entry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t keyOffset;
+        uint32_t keyLength;
+    };
+
+    std::vector<Entry> entries_;
+    std::string keys_;
+    std::string firstKey_;
+};
+
+}  // namespace DB
+
+#endif  // BLOCK_INDEX_HPP_
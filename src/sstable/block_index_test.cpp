@@ -0,0 +1,69 @@
+#include "block_index.hpp"
+#include <string>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+// Blocks ending at "c", "f" and "k", 100 bytes each.
+BlockIndex makeIndex() {
+    BlockIndex index;
+    index.setFirstKey("a");
+    index.add("c", {0, 100});
+    index.add("f", {100, 100});
+    index.add("k", {200, 100});
+    return index;
+}
+
+}  // namespace
+
+TEST(BlockIndex, FindsTheOnlyBlockThatCanHoldAKey) {
+    auto index = makeIndex();
+    EXPECT_EQ(index.find(""), 0u);
+    EXPECT_EQ(index.find("a"), 0u);
+    EXPECT_EQ(index.find("c"), 0u);
+    EXPECT_EQ(index.find("ca"), 1u);
+    EXPECT_EQ(index.find("f"), 1u);
+    EXPECT_EQ(index.find("g"), 2u);
+    EXPECT_EQ(index.find("k"), 2u);
+    EXPECT_EQ(index.find("ka"), index.size());
+}
+
+TEST(BlockIndex, EncodeDecodeRoundTrip) {
+    auto index = makeIndex();
+    std::string encoded;
+    index.encodeTo(encoded);
+
+    BlockIndex decoded;
+    ASSERT_TRUE(decoded.decodeFrom(encoded));
+    EXPECT_EQ(decoded.firstKey(), "a");
+    ASSERT_EQ(decoded.size(), index.size());
+    for (size_t i = 0; i < index.size(); ++i) {
+        EXPECT_EQ(decoded.lastKey(i), index.lastKey(i));
+        EXPECT_EQ(decoded.handle(i).offset, index.handle(i).offset);
+        EXPECT_EQ(decoded.handle(i).size, index.handle(i).size);
+    }
+}
+
+TEST(BlockIndex, EmptyRoundTrip) {
+    BlockIndex index;
+    std::string encoded;
+    index.encodeTo(encoded);
+    BlockIndex decoded;
+    ASSERT_TRUE(decoded.decodeFrom(encoded));
+    EXPECT_TRUE(decoded.empty());
+    EXPECT_EQ(decoded.find("any"), 0u);
+}
+
+TEST(BlockIndex, RejectsTruncatedInput) {
+    std::string encoded;
+    makeIndex().encodeTo(encoded);
+    for (size_t size = 0; size < encoded.size(); ++size) {
+        BlockIndex decoded;
+        EXPECT_FALSE(decoded.decodeFrom(encoded.substr(0, size))) << size;
+        EXPECT_TRUE(decoded.empty());
+    }
+}
+
+}  // namespace DB
@@ -0,0 +1,207 @@
+#include "block.hpp"
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+struct Record {
+    std::string key;
+    std::string value;
+    bool tombstone = false;
+};
+
+DBEntry entry(const Record &r) {
+    return DBEntry{std::vector<uint8_t>(r.value.begin(), r.value.end()),
+                   r.tombstone};
+}
+
+std::string buildBlock(
+    const std::vector<Record> &records,
+    size_t restartInterval = 16
+) {
+    BlockBuilder builder(restartInterval);
+    for (const auto &r : records) {
+        builder.add(r.key, entry(r));
+    }
+    return builder.finish();
+}
+
+std::vector<Record> readAll(const std::string &block) {
+    std::vector<Record> records;
+    BlockIterator it(block);
+    for (it.seekToFirst(); it.valid(); it.next()) {
+        records.push_back(
+            {std::string(it.key()), std::string(it.value()), it.tombstone()}
+        );
+    }
+    EXPECT_FALSE(it.corrupt());
+    return records;
+}
+
+void expectSame(
+    const std::vector<Record> &actual,
+    const std::vector<Record> &expected
+) {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        EXPECT_EQ(actual[i].key, expected[i].key) << i;
+        EXPECT_EQ(actual[i].value, expected[i].value) << i;
+        EXPECT_EQ(actual[i].tombstone, expected[i].tombstone) << i;
+    }
+}
+
+// user:00000:profile, user:00000:settings, user:00001:profile, ...
+std::vector<Record> userRecords(int users) {
+    std::vector<Record> records;
+    for (int i = 0; i < users; ++i) {
+        char id[16];
+        std::snprintf(id, sizeof(id), "user:%05d:", i);
+        auto n = std::to_string(i);
+        records.push_back({std::string(id) + "profile", "p" + n});
+        records.push_back({std::string(id) + "settings", "s" + n});
+    }
+    return records;
+}
+
+}  // namespace
+
+TEST(Block, RoundTrip) {
+    auto records = userRecords(100);
+    expectSame(readAll(buildBlock(records)), records);
+}
+
+TEST(Block, SingleRecord) {
+    std::vector<Record> records = {{"only", "value"}};
+    expectSame(readAll(buildBlock(records)), records);
+}
+
+TEST(Block, SharedPrefixesShrinkTheBlock) {
+    auto records = userRecords(100);
+    auto compressed = buildBlock(records, 16);
+    // With a restart at every record, every key is stored in full.
+    auto full = buildBlock(records, 1);
+    expectSame(readAll(compressed), records);
+    expectSame(readAll(full), records);
+    EXPECT_LT(compressed.size(), full.size() * 3 / 4);
+}
+
+TEST(Block, KeyThatExtendsThePrevious) {
+    std::vector<Record> records = {
+        {"a", "1"}, {"ab", "2"}, {"abc", "3"}, {"abd", "4"}, {"b", "5"}};
+    expectSame(readAll(buildBlock(records, 16)), records);
+}
+
+TEST(Block, EmptyValuesAndTombstones) {
+    std::vector<Record> records = {
+        {"a", "", false},
+        {"b", "", true},
+        {"c", "live", false},
+        {"d", "", true},
+        {"e", "", false},
+    };
+    expectSame(readAll(buildBlock(records, 2)), records);
+}
+
+TEST(Block, EmptyKey) {
+    std::vector<Record> records = {{"", "empty"}, {"a", "1"}};
+    expectSame(readAll(buildBlock(records)), records);
+}
+
+TEST(Block, SeekBetweenRestartPoints) {
+    // Even keys only, with a restart every four records.
+    std::vector<Record> records;
+    for (int i = 0; i < 100; i += 2) {
+        char key[16];
+        std::snprintf(key, sizeof(key), "key%03d", i);
+        records.push_back({key, std::to_string(i)});
+    }
+    auto block = buildBlock(records, 4);
+    BlockIterator it(block);
+    for (int i = 0; i < 99; ++i) {
+        char target[16];
+        std::snprintf(target, sizeof(target), "key%03d", i);
+        it.seek(target);
+        int expected = (i + 1) / 2 * 2;
+        ASSERT_TRUE(it.valid()) << target;
+        EXPECT_EQ(it.value(), std::to_string(expected)) << target;
+    }
+}
+
+TEST(Block, SeekOutsideTheKeys) {
+    std::vector<Record> records = {{"b", "1"}, {"d", "2"}, {"f", "3"}};
+    auto block = buildBlock(records, 1);
+    BlockIterator it(block);
+    it.seek("a");
+    ASSERT_TRUE(it.valid());
+    EXPECT_EQ(it.key(), "b");
+    it.seek("");
+    ASSERT_TRUE(it.valid());
+    EXPECT_EQ(it.key(), "b");
+    it.seek("g");
+    EXPECT_FALSE(it.valid());
+    EXPECT_FALSE(it.corrupt());
+}
+
+TEST(Block, SeekThenIterate) {
+    auto records = userRecords(50);
+    auto block = buildBlock(records, 16);
+    BlockIterator it(block);
+    it.seek("user:00020:");
+    for (size_t i = 40; i < records.size(); ++i) {
+        ASSERT_TRUE(it.valid());
+        EXPECT_EQ(it.key(), records[i].key);
+        it.next();
+    }
+    EXPECT_FALSE(it.valid());
+}
+
+TEST(Block, BuilderReset) {
+    BlockBuilder builder;
+    builder.add("z", entry({"z", "old"}));
+    builder.finish();
+    builder.reset();
+    EXPECT_TRUE(builder.empty());
+    std::vector<Record> records = {{"a", "1"}, {"b", "2"}};
+    for (const auto &r : records) {
+        builder.add(r.key, entry(r));
+    }
+    size_t expectedSize = builder.size();
+    const auto &block = builder.finish();
+    EXPECT_EQ(block.size(), expectedSize);
+    expectSame(readAll(block), records);
+}
+
+TEST(Block, RejectsBadRestartArray) {
+    auto block = buildBlock(userRecords(10));
+    EXPECT_TRUE(BlockIterator(block.substr(0, 2)).corrupt());
+
+    auto badCount = block;
+    badCount[badCount.size() - 1] = 0x7f;
+    EXPECT_TRUE(BlockIterator(badCount).corrupt());
+
+    auto noRestarts = block;
+    std::fill(noRestarts.end() - 4, noRestarts.end(), '\0');
+    EXPECT_TRUE(BlockIterator(noRestarts).corrupt());
+}
+
+TEST(Block, StopsAtMalformedRecord) {
+    std::vector<Record> records = {{"a", "1"}, {"b", "2"}, {"c", "3"}};
+    auto block = buildBlock(records, 16);
+    // Record two starts at offset 6: its shared length now exceeds the
+    // previous key.
+    block[6] = 5;
+    BlockIterator it(block);
+    it.seekToFirst();
+    ASSERT_TRUE(it.valid());
+    EXPECT_EQ(it.key(), "a");
+    it.next();
+    EXPECT_FALSE(it.valid());
+    EXPECT_TRUE(it.corrupt());
+}
+
+}  // namespace DB
@@ -0,0 +1,166 @@
+#include "compression.hpp"
+#include <cstdint>
+#include <cstring>
+#include "../crc32c/crc32c.hpp"
+#ifdef CLARITY_HAS_LZ4
+#include <lz4.h>
+#endif
+#ifdef CLARITY_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace DB {
+
+namespace {
+
+// Compresses `raw` onto the end of `out`; false if the codec is unavailable
+// or fails.
+bool compress(
+    std::string_view raw,
+    CompressionType type,
+    int level,
+    std::string &out
+) {
+    switch (type) {
+#ifdef CLARITY_HAS_LZ4
+        case CompressionType::kLz4: {
+            size_t start = out.size();
+            int bound = LZ4_compressBound(static_cast<int>(raw.size()));
+            out.resize(start + static_cast<size_t>(bound));
+            int n = LZ4_compress_default(
+                raw.data(), &out[start], static_cast<int>(raw.size()), bound
+            );
+            out.resize(start + static_cast<size_t>(n > 0 ? n : 0));
+            return n > 0;
+        }
+#endif
+#ifdef CLARITY_HAS_ZSTD
+        case CompressionType::kZstd: {
+            size_t start = out.size();
+            size_t bound = ZSTD_compressBound(raw.size());
+            out.resize(start + bound);
+            size_t n = ZSTD_compress(
+                &out[start], bound, raw.data(), raw.size(), level
+            );
+            bool ok = !ZSTD_isError(n);
+            out.resize(start + (ok ? n : 0));
+            return ok;
+        }
+#endif
+        default:
+            (void)raw;
+            (void)level;
+            (void)out;
+            return false;
+    }
+}
+
+bool decompress(
+    CompressionType type,
+    std::string_view payload,
+    size_t rawSize,
+    std::string &out
+) {
+    out.resize(rawSize);
+    switch (type) {
+#ifdef CLARITY_HAS_LZ4
+        case CompressionType::kLz4:
+            return LZ4_decompress_safe(
+                       payload.data(), &out[0],
+                       static_cast<int>(payload.size()),
+                       static_cast<int>(rawSize)
+                   ) == static_cast<int>(rawSize);
+#endif
+#ifdef CLARITY_HAS_ZSTD
+        case CompressionType::kZstd:
+            return ZSTD_decompress(
+                       &out[0], rawSize, payload.data(), payload.size()
+                   ) == rawSize;
+#endif
+        default:
+            (void)payload;
+            return false;
+    }
+}
+
+}  // namespace
+
+bool compressionSupported(CompressionType type) {
+    switch (type) {
+        case CompressionType::kNone:
+            return true;
+#ifdef CLARITY_HAS_LZ4
+        case CompressionType::kLz4:
+            return true;
+#endif
+#ifdef CLARITY_HAS_ZSTD
+        case CompressionType::kZstd:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+void encodeBlock(
+    std::string_view raw,
+    CompressionType type,
+    int level,
+    std::string &out
+) {
+    size_t start = out.size();
+    out.append(kBlockHeaderSize, '\0');
+    if (type != CompressionType::kNone &&
+        (!compress(raw, type, level, out) ||
+         out.size() - start - kBlockHeaderSize > raw.size() - raw.size() / 8)) {
+        out.resize(start + kBlockHeaderSize);
+        type = CompressionType::kNone;
+    }
+    if (type == CompressionType::kNone) {
+        out.append(raw.data(), raw.size());
+    }
+    out[start] = static_cast<char>(type);
+    uint32_t rawSize = static_cast<uint32_t>(raw.size());
+    std::memcpy(&out[start + 1], &rawSize, sizeof(rawSize));
+    uint32_t crc = crc32c::extend(
+        crc32c::value(&out[start], 5), out.data() + start + kBlockHeaderSize,
+        out.size() - start - kBlockHeaderSize
+    );
+    crc = crc32c::mask(crc);
+    std::memcpy(&out[start + 5], &crc, sizeof(crc));
+}
+
+bool decodeBlock(std::string &block) {
+    if (block.size() < kBlockHeaderSize) {
+        return false;
+    }
+    uint32_t rawSize;
+    uint32_t stored;
+    std::memcpy(&rawSize, &block[1], sizeof(rawSize));
+    std::memcpy(&stored, &block[5], sizeof(stored));
+    uint32_t crc = crc32c::extend(
+        crc32c::value(block.data(), 5), block.data() + kBlockHeaderSize,
+        block.size() - kBlockHeaderSize
+    );
+    if (crc != crc32c::unmask(stored)) {
+        return false;
+    }
+    auto type = static_cast<CompressionType>(block[0]);
+    std::string_view payload(block);
+    payload.remove_prefix(kBlockHeaderSize);
+    if (type == CompressionType::kNone) {
+        if (payload.size() != rawSize) {
+            return false;
+        }
+        block.erase(0, kBlockHeaderSize);
+        return true;
+    }
+    std::string raw;
+    if (!decompress(type, payload, rawSize, raw)) {
+        return false;
+    }
+    block.swap(raw);
+    return true;
+}
+
+}  // namespace DB
@@ -0,0 +1,34 @@
+#ifndef COMPRESSION_HPP_
+#define COMPRESSION_HPP_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "compression_type.hpp"
+
+namespace DB {
+
+// Stored block: [codec:1][raw size:4][masked crc32c:4][payload]. The CRC
+// covers the codec, the raw size and the payload.
+constexpr size_t kBlockHeaderSize = 9;
+
+// Whether this build can write and read `type`.
+bool compressionSupported(CompressionType type);
+
+// Appends `raw` to `out` as a stored block. Falls back to kNone when the
+// codec is not compiled in or does not save at least 1/8 of the size.
+// `level` is passed to zstd and ignored by the other codecs.
+void encodeBlock(
+    std::string_view raw,
+    CompressionType type,
+    int level,
+    std::string &out
+);
+
+// Replaces a stored block with its raw contents. Fails on a checksum
+// mismatch, an unknown or unsupported codec, or a bad payload.
+bool decodeBlock(std::string &block);
+
+}  // namespace DB
+
+#endif  // COMPRESSION_HPP_
@@ -0,0 +1,152 @@
+#include "compression.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <userver/utest/utest.hpp>
+#include "../crc32c/crc32c.hpp"
+
+namespace DB {
+
+namespace {
+
+constexpr CompressionType kCodecs[] = {
+    CompressionType::kNone, CompressionType::kLz4, CompressionType::kZstd};
+
+// JSON-like text, which every codec shrinks well below 7/8.
+std::string compressible() {
+    std::string raw;
+    for (int i = 0; i < 200; ++i) {
+        raw += "{\"user\":" + std::to_string(i) + ",\"name\":\"someone\"}";
+    }
+    return raw;
+}
+
+// Bytes no codec can shrink.
+std::string incompressible() {
+    std::string raw(4096, '\0');
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (auto &c : raw) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        c = static_cast<char>(x);
+    }
+    return raw;
+}
+
+CompressionType storedCodec(const std::string &block) {
+    return static_cast<CompressionType>(block[0]);
+}
+
+// Stores a valid CRC over a hand-edited block, so only the payload is wrong.
+void restampCrc(std::string &block) {
+    uint32_t crc = crc32c::mask(crc32c::extend(
+        crc32c::value(block.data(), 5), block.data() + kBlockHeaderSize,
+        block.size() - kBlockHeaderSize
+    ));
+    std::memcpy(&block[5], &crc, sizeof(crc));
+}
+
+}  // namespace
+
+TEST(Compression, RoundTrip) {
+    for (auto codec : kCodecs) {
+        for (const auto &raw :
+             {compressible(), incompressible(), std::string()}) {
+            std::string block;
+            encodeBlock(raw, codec, 3, block);
+            ASSERT_TRUE(decodeBlock(block)) << static_cast<int>(codec);
+            EXPECT_EQ(block, raw) << static_cast<int>(codec);
+        }
+    }
+}
+
+TEST(Compression, CompressesWhenSupported) {
+    auto raw = compressible();
+    for (auto codec : kCodecs) {
+        std::string block;
+        encodeBlock(raw, codec, 3, block);
+        if (codec != CompressionType::kNone && compressionSupported(codec)) {
+            EXPECT_EQ(storedCodec(block), codec);
+            EXPECT_LT(block.size(), raw.size() / 2);
+        } else {
+            // Codecs missing from this build fall back to raw storage.
+            EXPECT_EQ(storedCodec(block), CompressionType::kNone);
+            EXPECT_EQ(block.size(), kBlockHeaderSize + raw.size());
+        }
+    }
+}
+
+TEST(Compression, StoresIncompressibleBlocksRaw) {
+    auto raw = incompressible();
+    for (auto codec : kCodecs) {
+        std::string block;
+        encodeBlock(raw, codec, 3, block);
+        EXPECT_EQ(storedCodec(block), CompressionType::kNone);
+        EXPECT_EQ(block.size(), kBlockHeaderSize + raw.size());
+    }
+}
+
+TEST(Compression, AppendsToOutput) {
+    std::string out = "prefix";
+    encodeBlock(compressible(), CompressionType::kLz4, 3, out);
+    EXPECT_EQ(out.compare(0, 6, "prefix"), 0);
+    std::string block = out.substr(6);
+    ASSERT_TRUE(decodeBlock(block));
+    EXPECT_EQ(block, compressible());
+}
+
+TEST(Compression, RejectsCorruptBytes) {
+    for (auto codec : kCodecs) {
+        std::string encoded;
+        encodeBlock(compressible(), codec, 3, encoded);
+        for (size_t i = 0; i < encoded.size(); i += 7) {
+            auto block = encoded;
+            block[i] ^= 0x01;
+            EXPECT_FALSE(decodeBlock(block)) << static_cast<int>(codec) << i;
+        }
+    }
+}
+
+TEST(Compression, RejectsTruncatedBlocks) {
+    std::string encoded;
+    encodeBlock(compressible(), CompressionType::kLz4, 3, encoded);
+    for (size_t size : {size_t{0}, kBlockHeaderSize - 1, encoded.size() - 1}) {
+        auto block = encoded.substr(0, size);
+        EXPECT_FALSE(decodeBlock(block)) << size;
+    }
+}
+
+TEST(Compression, RejectsBadPayloadWithValidChecksum) {
+    for (auto codec : {CompressionType::kLz4, CompressionType::kZstd}) {
+        if (!compressionSupported(codec)) {
+            continue;
+        }
+        std::string encoded;
+        encodeBlock(compressible(), codec, 3, encoded);
+        ASSERT_EQ(storedCodec(encoded), codec);
+        // Garbage in place of the compressed bytes.
+        auto block = encoded;
+        for (size_t i = kBlockHeaderSize; i < block.size(); ++i) {
+            block[i] = static_cast<char>(0xff - i);
+        }
+        restampCrc(block);
+        EXPECT_FALSE(decodeBlock(block)) << static_cast<int>(codec);
+
+        // A raw size that does not match the payload.
+        block = encoded;
+        block[1] ^= 0x01;
+        restampCrc(block);
+        EXPECT_FALSE(decodeBlock(block)) << static_cast<int>(codec);
+    }
+}
+
+TEST(Compression, RejectsUnknownCodec) {
+    std::string block;
+    encodeBlock("data", CompressionType::kNone, 0, block);
+    block[0] = 0x7f;
+    restampCrc(block);
+    EXPECT_FALSE(decodeBlock(block));
+}
+
+}  // namespace DB
@@ -0,0 +1,20 @@
+#ifndef COMPRESSION_TYPE_HPP_
+#define COMPRESSION_TYPE_HPP_
+
+#include <cstdint>
+
+namespace DB {
+
+// Codec of an SSTable data block. The value is stored in each block header,
+// so it must never change for an existing codec.
+enum class CompressionType : uint8_t {
+    kNone = 0,
+    // Needs the build to find liblz4 (CLARITY_HAS_LZ4).
+    kLz4 = 1,
+    // Needs the build to find libzstd (CLARITY_HAS_ZSTD).
+    kZstd = 2,
+};
+
+}  // namespace DB
+
+#endif  // COMPRESSION_TYPE_HPP_
@@ -0,0 +1,62 @@
+#include "footer.hpp"
+#include <cstring>
+#include "../crc32c/crc32c.hpp"
+
+namespace DB {
+
+namespace {
+
+template <typename T>
+void appendFixed(std::string &out, T v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+template <typename T>
+T readFixed(const char *&p) {
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return v;
+}
+
+}  // namespace
+
+void Footer::encodeTo(std::string &out) const {
+    size_t start = out.size();
+    appendFixed(out, filter.offset);
+    appendFixed(out, filter.size);
+    appendFixed(out, filterCrc);
+    appendFixed(out, index.offset);
+    appendFixed(out, index.size);
+    appendFixed(out, indexCrc);
+    appendFixed(out, version);
+    appendFixed(out, static_cast<uint32_t>(filterType));
+    appendFixed(out, prefixExtractor);
+    appendFixed(
+        out, crc32c::mask(crc32c::value(out.data() + start, out.size() - start))
+    );
+    appendFixed(out, kMagic);
+}
+
+bool Footer::decodeFrom(std::string_view in) {
+    if (in.size() != kEncodedLength) {
+        return false;
+    }
+    const char *p = in.data();
+    filter.offset = readFixed<uint64_t>(p);
+    filter.size = readFixed<uint32_t>(p);
+    filterCrc = readFixed<uint32_t>(p);
+    index.offset = readFixed<uint64_t>(p);
+    index.size = readFixed<uint32_t>(p);
+    indexCrc = readFixed<uint32_t>(p);
+    version = readFixed<uint32_t>(p);
+    filterType = static_cast<FilterType>(readFixed<uint32_t>(p));
+    prefixExtractor = readFixed<uint32_t>(p);
+    size_t covered = static_cast<size_t>(p - in.data());
+    uint32_t crc = crc32c::unmask(readFixed<uint32_t>(p));
+    uint64_t magic = readFixed<uint64_t>(p);
+    return magic == kMagic && version == kFormatVersion &&
+           crc32c::value(in.data(), covered) == crc;
+}
+
+}  // namespace DB
@@ -0,0 +1,47 @@
+#ifndef FOOTER_HPP_
+#define FOOTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "../bloom/filter_type.hpp"
+#include "block_index.hpp"
+
+namespace DB {
+
+// Fixed-size trailer at the end of every table file. It locates the filter
+// and index sections, so opening a table reads the footer and then those
+// two sections, never the data blocks.
+//
+// [filter offset:8][filter size:4][filter crc:4]
+// [index offset:8][index size:4][index crc:4]
+// [format version:4][filter type:4][prefix extractor:4]
+// [footer crc:4][magic:8]
+//
+// Section CRCs are masked crc32c of the section bytes; the footer CRC covers
+// everything before it.
+struct Footer {
+    static constexpr uint64_t kMagic = 0x31424154534c4443ull;  // "CDLSTAB1"
+    static constexpr uint32_t kFormatVersion = 8;
+    static constexpr size_t kEncodedLength = 56;
+
+    BlockHandle filter;
+    uint32_t filterCrc = 0;
+    BlockHandle index;
+    uint32_t indexCrc = 0;
+    uint32_t version = kFormatVersion;
+    // How the filter section is laid out and probed.
+    FilterType filterType = FilterType::kBloom;
+    // PrefixExtractor::id() of the extractor whose prefixes are in the
+    // filter; 0 if none are.
+    uint32_t prefixExtractor = 0;
+
+    void encodeTo(std::string &out) const;
+    // Fails on a wrong magic number, an unknown version or a bad checksum.
+    bool decodeFrom(std::string_view in);
+};
+
+}  // namespace DB
+
+#endif  // FOOTER_HPP_
@@ -0,0 +1,102 @@
+#include "footer.hpp"
+#include <cstring>
+#include <string>
+#include <userver/utest/utest.hpp>
+#include "../crc32c/crc32c.hpp"
+
+namespace DB {
+
+namespace {
+
+// Offset of the version field and of the footer CRC.
+constexpr size_t kVersionOffset = 32;
+constexpr size_t kCrcOffset = 44;
+
+Footer makeFooter() {
+    Footer footer;
+    footer.filter = {123456789012ull, 4096};
+    footer.filterCrc = 0xdeadbeef;
+    footer.index = {123456793108ull, 777};
+    footer.indexCrc = 0x01020304;
+    footer.filterType = FilterType::kXor8;
+    footer.prefixExtractor = 0x023a0002;
+    return footer;
+}
+
+// Stores a valid CRC over a hand-edited footer, so only the field under test
+// is wrong.
+void restampCrc(std::string &encoded) {
+    uint32_t crc = crc32c::mask(crc32c::value(encoded.data(), kCrcOffset));
+    std::memcpy(&encoded[kCrcOffset], &crc, sizeof(crc));
+}
+
+}  // namespace
+
+TEST(Footer, RoundTrip) {
+    auto footer = makeFooter();
+    std::string encoded = "table data";
+    footer.encodeTo(encoded);
+    ASSERT_EQ(encoded.size(), 10 + Footer::kEncodedLength);
+
+    Footer decoded;
+    ASSERT_TRUE(decoded.decodeFrom(std::string_view(encoded).substr(10)));
+    EXPECT_EQ(decoded.filter.offset, footer.filter.offset);
+    EXPECT_EQ(decoded.filter.size, footer.filter.size);
+    EXPECT_EQ(decoded.filterCrc, footer.filterCrc);
+    EXPECT_EQ(decoded.index.offset, footer.index.offset);
+    EXPECT_EQ(decoded.index.size, footer.index.size);
+    EXPECT_EQ(decoded.indexCrc, footer.indexCrc);
+    EXPECT_EQ(decoded.version, Footer::kFormatVersion);
+    EXPECT_EQ(decoded.filterType, FilterType::kXor8);
+    EXPECT_EQ(decoded.prefixExtractor, footer.prefixExtractor);
+}
+
+TEST(Footer, EndsWithMagic) {
+    std::string encoded;
+    makeFooter().encodeTo(encoded);
+    uint64_t magic = 0;
+    std::memcpy(&magic, encoded.data() + encoded.size() - 8, sizeof(magic));
+    EXPECT_EQ(magic, Footer::kMagic);
+}
+
+TEST(Footer, RejectsWrongLength) {
+    std::string encoded;
+    makeFooter().encodeTo(encoded);
+    Footer decoded;
+    EXPECT_FALSE(decoded.decodeFrom(encoded.substr(1)));
+    EXPECT_FALSE(decoded.decodeFrom(encoded + '\0'));
+    EXPECT_FALSE(decoded.decodeFrom({}));
+}
+
+TEST(Footer, RejectsOtherVersions) {
+    for (uint32_t version :
+         {0u, Footer::kFormatVersion - 1, Footer::kFormatVersion + 1}) {
+        std::string encoded;
+        makeFooter().encodeTo(encoded);
+        std::memcpy(&encoded[kVersionOffset], &version, sizeof(version));
+        restampCrc(encoded);
+        Footer decoded;
+        EXPECT_FALSE(decoded.decodeFrom(encoded)) << version;
+    }
+}
+
+TEST(Footer, RejectsBadMagic) {
+    std::string encoded;
+    makeFooter().encodeTo(encoded);
+    encoded.back() ^= 1;
+    Footer decoded;
+    EXPECT_FALSE(decoded.decodeFrom(encoded));
+}
+
+TEST(Footer, RejectsAnyFlippedBit) {
+    std::string encoded;
+    makeFooter().encodeTo(encoded);
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        auto corrupt = encoded;
+        corrupt[i] ^= 0x10;
+        Footer decoded;
+        EXPECT_FALSE(decoded.decodeFrom(corrupt)) << i;
+    }
+}
+
+}  // namespace DB
@@ -1,177 +1,309 @@
 #include "sstable.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include "../configs/db_config.hpp"
+#include "../crc32c/crc32c.hpp"
+#include "compression.hpp"
+#include "footer.hpp"
+#include "sstable_builder.hpp"
 
 namespace DB {
 
-static constexpr const char *DATA_BLOOM_MARKER = "##BLOOM##\n";
-static constexpr const char *BLOOM_INDEX_MARKER = "##INDEX##\n";
-
-SSTable::SSTable(const std::string &file) : filename(file), bf_() {
+SSTable::SSTable(const std::string &file, std::shared_ptr<BlockCache> cache)
+    : filename(file), cache_(std::move(cache)) {
+  if (cache_) {
+    cacheId_ = cache_->newFileId();
+  }
   if (std::filesystem::exists(filename) &&
       std::filesystem::file_size(filename) > 0) {
     loadIndex();
   }
 }
 
-void SSTable::loadIndex() {
-  std::lock_guard<std::mutex> lock(indexMutex);
-  index.clear();
-
-  std::ifstream in(filename, std::ios::binary);
-  if (!in)
-    throw std::runtime_error("Cannot open SSTable: " + filename);
-
-  const std::string bloomMarker(DATA_BLOOM_MARKER);
-  std::string window;
-  window.reserve(bloomMarker.size());
-  char ch;
-  while (in.get(ch)) {
-    window.push_back(ch);
-    if (window.size() > bloomMarker.size())
-      window.erase(0, 1);
-    if (window == bloomMarker)
-      break;
-  }
-  if (in.eof())
-    return;
-
-  bf_.deserialize(in);
-
-  const std::string indexMarker(BLOOM_INDEX_MARKER);
-  window.clear();
-  while (in.get(ch)) {
-    window.push_back(ch);
-    if (window.size() > indexMarker.size())
-      window.erase(0, 1);
-    if (window == indexMarker)
-      break;
+SSTable::~SSTable() {
+  if (fd_ >= 0) {
+    ::close(fd_);
   }
-  if (in.eof())
-    return;
-
-  size_t count = 0;
-  in >> count;
-  for (size_t i = 0; i < count; ++i) {
-    std::string key;
-    long long off;
-    in >> key >> off;
-    index[key] = static_cast<std::streampos>(off);
+  if (obsolete_.load()) {
+    std::error_code ec;
+    std::filesystem::remove(filename, ec);
   }
 }
 
-void SSTable::write(SkipListMap<std::string, DBEntry> &data) {
-  std::ofstream out(filename, std::ios::binary | std::ios::trunc);
-  if (!out) {
-    throw std::runtime_error("Cannot open SSTable for write: " + filename);
+// Reads exactly `size` bytes at `offset`.
+static bool preadFully(int fd, char *buf, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t n = ::pread(fd, buf, size, static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    buf += n;
+    size -= static_cast<size_t>(n);
+    offset += static_cast<uint64_t>(n);
   }
+  return true;
+}
 
-  bf_ = BloomFilter(data.size() * 10, 7);
-  std::map<std::string, std::streampos> newIndex;
-
-  for (auto it = data.begin(); it != data.end(); ++it) {
-    const auto &kv = *it;
-    const std::string &key = kv.first;
-    const DBEntry &entry = kv.second;
+static bool checkSection(std::string_view data, uint32_t maskedCrc) {
+  return crc32c::value(data.data(), data.size()) == crc32c::unmask(maskedCrc);
+}
 
-    bf_.add(key);
+void SSTable::loadIndex() {
+  // Kept open for the lifetime of the table; every block read is a pread on
+  // it, so lookups need neither open() nor a lock.
+  fd_ = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0)
+    throw std::runtime_error("Cannot open SSTable: " + filename);
+  auto fail = [&](const char *what) {
+    ::close(fd_);
+    fd_ = -1;
+    throw std::runtime_error(std::string(what) + ": " + filename);
+  };
+
+  struct stat st {};
+  if (::fstat(fd_, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < Footer::kEncodedLength)
+    fail("SSTable too short");
+  uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+  fileSize_ = fileSize;
+
+  std::string buf(Footer::kEncodedLength, '\0');
+  Footer footer;
+  if (!preadFully(fd_, &buf[0], buf.size(), fileSize - buf.size()) ||
+      !footer.decodeFrom(buf))
+    fail("Bad SSTable footer");
+  if (footer.filter.offset + footer.filter.size > fileSize ||
+      footer.index.offset + footer.index.size > fileSize)
+    fail("SSTable sections out of range");
+
+  // The builder writes the filter and the index back to back, so both come
+  // in with a single read.
+  uint64_t metaBegin = std::min(footer.filter.offset, footer.index.offset);
+  uint64_t metaEnd = std::max(footer.filter.offset + footer.filter.size,
+                              footer.index.offset + footer.index.size);
+  buf.resize(metaEnd - metaBegin);
+  if (!buf.empty() && !preadFully(fd_, &buf[0], buf.size(), metaBegin))
+    fail("Cannot read SSTable metadata");
+  std::string_view filter(buf.data() + (footer.filter.offset - metaBegin),
+                          footer.filter.size);
+  std::string_view index(buf.data() + (footer.index.offset - metaBegin),
+                         footer.index.size);
+  if (!checkSection(filter, footer.filterCrc) ||
+      !(filter_ = decodeFilter(footer.filterType, filter)))
+    fail("Corrupt SSTable filter");
+  prefixExtractor_ = footer.prefixExtractor;
+  if (!checkSection(index, footer.indexCrc) || !index_.decodeFrom(index))
+    fail("Corrupt SSTable index");
+  pinMetadata();
+}
 
-    std::streampos pos = out.tellp();
-    newIndex[key] = pos;
+void SSTable::pinMetadata() {
+  if (cache_) {
+    // No block lives at this offset, so the key cannot collide.
+    metadataPin_ = cache_->pin(cacheId_, UINT64_MAX, nullptr,
+                               index_.memoryUsage() + filter_->memoryUsage());
+  }
+}
 
-    uint32_t keySize = static_cast<uint32_t>(key.size());
-    out.write(reinterpret_cast<const char *>(&keySize), sizeof(keySize));
-    out.write(key.data(), keySize);
+bool SSTable::readBlock(BlockHandle handle, std::string &out) const {
+  out.resize(handle.size);
+  return fd_ >= 0 && preadFully(fd_, &out[0], handle.size, handle.offset) &&
+         decodeBlock(out);
+}
 
-    uint32_t valueSize = static_cast<uint32_t>(entry.value.size());
-    out.write(reinterpret_cast<const char *>(&valueSize), sizeof(valueSize));
-    if (valueSize > 0) {
-      out.write(reinterpret_cast<const char *>(entry.value.data()), valueSize);
+BlockCache::Block SSTable::readBlockCached(BlockHandle handle) const {
+  if (cache_) {
+    if (auto cached = cache_->lookup(cacheId_, handle.offset)) {
+      return cached;
     }
-
-    uint8_t tomb = entry.tombstone ? 1 : 0;
-    out.write(reinterpret_cast<const char *>(&tomb), sizeof(tomb));
   }
-
-  out << DATA_BLOOM_MARKER;
-
-  bf_.serialize(out);
-
-  out << BLOOM_INDEX_MARKER;
-  out << newIndex.size() << "\n";
-  for (const auto &e : newIndex) {
-    out << e.first << " " << static_cast<long long>(e.second) << "\n";
+  auto block = std::make_shared<std::string>();
+  if (!readBlock(handle, *block)) {
+    return nullptr;
+  }
+  if (cache_) {
+    cache_->insert(cacheId_, handle.offset, block);
   }
+  return block;
+}
 
-  out.flush();
-  out.close();
+void SSTable::write(const MemTable &data, RateLimiter *limiter,
+                    PrefixExtractor prefixExtractor) {
+  SSTableBuilder builder(filename, limiter, DBConfig::kFilterTypeByLevel[0],
+                         prefixExtractor);
+  for (auto it = data.begin(); it != data.end(); ++it) {
+    const auto &kv = *it;
+    builder.add(kv.first, kv.second);
+  }
+  builder.finish();
 
-  {
-    std::lock_guard<std::mutex> lock(indexMutex);
-    index = std::move(newIndex);
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
   }
+  loadIndex();
 }
 
-bool SSTable::find(const std::string &key, DBEntry &entry) const {
-  std::lock_guard<std::mutex> lock(indexMutex);
+bool SSTable::mayContainPrefix(const PrefixExtractor &extractor,
+                               std::string_view prefix) const {
+  if (!filter_ || prefixExtractor_ == 0 || prefixExtractor_ != extractor.id())
+    return true;
+  // Every key starting with `prefix` extracts to the same prefix as
+  // `prefix` itself, and the builder added that prefix for each such key.
+  auto extracted = extractor.extract(prefix);
+  return !extracted || filter_->possiblyContainsPrefix(*extracted);
+}
 
-  if (!bf_.possiblyContains(key)) {
+bool SSTable::get(std::string_view key, ValueRef &ref) const {
+  if (!filter_ || !filter_->possiblyContains(key)) {
     return false;
   }
 
-  auto it = index.find(key);
-  if (it == index.end()) {
+  size_t block = index_.find(key);
+  if (block == index_.size()) {
     return false;
   }
 
-  std::ifstream in(filename, std::ios::binary);
-  if (!in) {
+  // A read error must not look like a miss: the lookup would go on to an
+  // older table and could return a value this one overrides.
+  auto data = readBlockCached(index_.handle(block));
+  if (!data) {
+    throw std::runtime_error("Cannot read SSTable block: " + filename);
+  }
+  BlockIterator iter(*data);
+  iter.seek(key);
+  if (iter.corrupt()) {
+    throw std::runtime_error("Corrupt SSTable block: " + filename);
+  }
+  if (!iter.valid() || iter.key() != key) {
     return false;
   }
+  ref.value = iter.value();
+  ref.tombstone = iter.tombstone();
+  ref.block = std::move(data);
+  return true;
+}
 
-  in.seekg(it->second);
+std::unique_ptr<KVIterator> SSTable::newIterator(RateLimiter *limiter) const {
+  return std::make_unique<Iterator>(*this, limiter);
+}
 
-  uint32_t keySize = 0;
-  in.read(reinterpret_cast<char *>(&keySize), sizeof(keySize));
-  std::string fileKey(keySize, '\0');
-  in.read(&fileKey[0], keySize);
-  if (fileKey != key) {
-    return false;
-  }
+SSTable::Iterator::Iterator(const SSTable &table, RateLimiter *limiter)
+    : table_(table), limiter_(limiter), block_(table.index_.size()) {}
 
-  uint32_t valueSize = 0;
-  in.read(reinterpret_cast<char *>(&valueSize), sizeof(valueSize));
-  std::vector<uint8_t> blob(valueSize);
-  if (valueSize > 0) {
-    in.read(reinterpret_cast<char *>(blob.data()), valueSize);
+bool SSTable::Iterator::valid() const { return iter_.valid(); }
+
+void SSTable::Iterator::seekToFirst() {
+  sequential_ = false;
+  loadBlock(0);
+  skipEmptyBlocks();
+}
+
+void SSTable::Iterator::seek(std::string_view target) {
+  sequential_ = false;
+  loadBlock(table_.index_.find(target));
+  if (iter_.valid()) {
+    iter_.seek(target);
   }
+  skipEmptyBlocks();
+}
 
-  uint8_t tomb = 0;
-  in.read(reinterpret_cast<char *>(&tomb), sizeof(tomb));
+void SSTable::Iterator::next() {
+  iter_.next();
+  skipEmptyBlocks();
+}
 
-  entry.value = std::move(blob);
-  entry.tombstone = (tomb == 1);
-  return true;
+std::string_view SSTable::Iterator::key() const { return iter_.key(); }
+
+const DBEntry &SSTable::Iterator::entry() const { return entry_; }
+
+bool SSTable::Iterator::ok() const { return !failed_; }
+
+void SSTable::Iterator::fail() {
+  failed_ = true;
+  block_ = table_.index_.size();
+  iter_ = BlockIterator();
+  data_ = nullptr;
 }
 
-std::map<std::string, DBEntry> SSTable::dump() const {
-  std::map<std::string, std::streampos> idx_copy;
-  {
-    std::lock_guard<std::mutex> lock(indexMutex);
-    idx_copy = index;
+void SSTable::Iterator::loadBlock(size_t block) {
+  if (failed_) {
+    return;
+  }
+  block_ = block;
+  iter_ = BlockIterator();
+  data_ = nullptr;
+  if (block_ >= table_.index_.size()) {
+    return;
   }
+  data_ = fetchBlock(table_.index_.handle(block_));
+  if (!data_) {
+    fail();
+    return;
+  }
+  iter_ = BlockIterator(*data_);
+  iter_.seekToFirst();
+}
 
-  std::map<std::string, DBEntry> outMap;
-  for (auto &p : idx_copy) {
-    DBEntry e;
-    if (find(p.first, e)) {
-      outMap[p.first] = std::move(e);
+BlockCache::Block SSTable::Iterator::fetchBlock(BlockHandle handle) {
+  if (table_.cache_) {
+    if (auto cached = table_.cache_->lookup(table_.cacheId_, handle.offset)) {
+      return cached;
     }
   }
-  return outMap;
+  if (handle.offset < readaheadOffset_ ||
+      handle.offset + handle.size > readaheadOffset_ + readahead_.size()) {
+    // Double the window for every sequential refill; start over after a
+    // seek.
+    readaheadWindow_ =
+        sequential_ ? std::min(std::max(readaheadWindow_ * 2,
+                                        DBConfig::kSstableBlockSize * 4),
+                               DBConfig::kIteratorReadahead)
+                    : 0;
+    const auto &index = table_.index_;
+    auto last = index.handle(index.size() - 1);
+    uint64_t dataEnd = last.offset + last.size;
+    size_t want = std::max<size_t>(
+        handle.size,
+        std::min<uint64_t>(readaheadWindow_, dataEnd - handle.offset));
+    if (limiter_) {
+      limiter_->request(want);
+    }
+    readahead_.resize(want);
+    readaheadOffset_ = handle.offset;
+    if (table_.fd_ < 0 ||
+        !preadFully(table_.fd_, &readahead_[0], want, handle.offset)) {
+      readahead_.clear();
+      return nullptr;
+    }
+  }
+  auto block = std::make_shared<std::string>(
+      readahead_, handle.offset - readaheadOffset_, handle.size);
+  if (!decodeBlock(*block)) {
+    return nullptr;
+  }
+  return block;
+}
+
+void SSTable::Iterator::skipEmptyBlocks() {
+  while (!iter_.valid() && !iter_.corrupt() &&
+         block_ < table_.index_.size()) {
+    sequential_ = true;
+    loadBlock(block_ + 1);
+  }
+  if (iter_.corrupt()) {
+    fail();
+  } else if (iter_.valid()) {
+    iter_.copyEntry(entry_);
+  }
 }
 
 } // namespace DB
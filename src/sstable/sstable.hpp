@@ -1,46 +1,152 @@
 #ifndef SSTABLE_HPP_
 #define SSTABLE_HPP_
 
-#include "../bloom/bloom.hpp"
+#include "../bloom/filter.hpp"
+#include "../bloom/prefix_extractor.hpp"
 #include "../base/db_entry.hpp"
-#include "../skiplist/skiplist.hpp"
+#include "../cache/block_cache.hpp"
+#include "../configs/db_config.hpp"
+#include "../base/memtable.hpp"
+#include "../iterator/kv_iterator.hpp"
+#include "../ratelimiter/rate_limiter.hpp"
+#include "block.hpp"
+#include "block_index.hpp"
+#include <atomic>
 #include <filesystem>
 #include <fstream>
-#include <map>
-#include <mutex>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace DB {
-class ISSTable {
-public:
-    virtual void write(SkipListMap<std::string, DBEntry> &data) = 0;
-    virtual bool find(const std::string &key, DBEntry &entry) const = 0;
-    virtual std::map<std::string, DBEntry> dump() const = 0;
-
-    virtual ~ISSTable() {}
+// Layout: data blocks of about DBConfig::kSstableBlockSize bytes before
+// compression (each with a codec header, see compression.hpp), the bloom
+// filter, a sparse index with one entry per block, and a fixed Footer that
+// locates the last two. A lookup searches the index and reads one block.
+// A value found by SSTable::get. It points into the block it was read from
+// and keeps that block alive, so no copy is made until the caller needs one.
+struct ValueRef {
+    std::shared_ptr<const std::string> block;
+    std::string_view value;
+    bool tombstone = false;
 };
 
-class SSTable : public ISSTable {
+class SSTable {
 private:
     std::string filename;
-    mutable std::mutex indexMutex;
-    std::map<std::string, std::streampos> index;
-    BloomFilter bf_;
+    int fd_ = -1;
+    uint64_t fileSize_ = 0;
+    BlockIndex index_;
+    // Set by loadIndex(); its type comes from the footer.
+    std::unique_ptr<KeyFilter> filter_;
+    // Footer's PrefixExtractor::id().
+    uint32_t prefixExtractor_ = 0;
+    std::atomic<bool> obsolete_{false};
+    std::shared_ptr<BlockCache> cache_;
+    uint64_t cacheId_ = 0;
+    // Charges the in-memory index and filter to the cache.
+    BlockCache::Handle metadataPin_;
 
     void loadIndex();
+    void pinMetadata();
+    // Reads and decompresses one block.
+    bool readBlock(BlockHandle handle, std::string &out) const;
+    // Point-lookup read: goes through the cache and fills it on a miss.
+    BlockCache::Block readBlockCached(BlockHandle handle) const;
 
 public:
-    explicit SSTable(const std::string &file);
-    void write(SkipListMap<std::string, DBEntry> &data) override;
-    bool find(const std::string &key, DBEntry &entry) const override;
-    std::map<std::string, DBEntry> dump() const override;
+    explicit SSTable(const std::string &file,
+                     std::shared_ptr<BlockCache> cache = nullptr);
+    ~SSTable();
 
-    const std::map<std::string, std::streampos> &GetIndex() const {
-        return index;
-    }
+    // Background writers pass a limiter to pace the file writes.
+    void write(
+        const MemTable &data,
+        RateLimiter *limiter = nullptr,
+        PrefixExtractor prefixExtractor = DBConfig::kPrefixExtractor
+    );
+    // Lookups are lock-free; write() must not run concurrently with them.
+    // Throws if the block that would hold the key cannot be read, rather
+    // than reporting the key as absent.
+    bool get(std::string_view key, ValueRef &ref) const;
+
+    const BlockIndex &GetIndex() const { return index_; }
 
     const std::string &getFilename() const { return filename; }
+
+    uint64_t fileSize() const { return fileSize_; }
+    bool empty() const { return index_.empty(); }
+    // Key range of the table; both empty for an empty table.
+    std::string_view smallestKey() const { return index_.firstKey(); }
+    std::string_view largestKey() const {
+        return index_.empty() ? std::string_view()
+                              : index_.lastKey(index_.size() - 1);
+    }
+    // Whether some key may fall in [start, end); an empty end is open.
+    bool overlaps(std::string_view start, std::string_view end) const {
+        return !empty() && largestKey() >= start &&
+               (end.empty() || smallestKey() < end);
+    }
+    // False only if no key in the table starts with `prefix`. Answered by
+    // the filter when `extractor` is the one the table was written with and
+    // `prefix` is long enough to extract from; otherwise true.
+    bool mayContainPrefix(const PrefixExtractor &extractor,
+                          std::string_view prefix) const;
+
+    class Iterator;
+    // The table must outlive the iterator.
+    // Disk reads of the iterator are charged to `limiter` if given.
+    std::unique_ptr<KVIterator> newIterator(
+        RateLimiter *limiter = nullptr
+    ) const;
+
+    // The file is deleted once the last reference to this table goes away,
+    // so lock-free readers holding an older table list can still use it.
+    void markObsolete() { obsolete_.store(true); }
+};
+
+// Streams the table in key order, holding one decoded block at a time.
+// Consecutive blocks are read through a readahead buffer that grows while
+// the access stays sequential (up to DBConfig::kIteratorReadahead), so a
+// full scan issues large reads while a short range scan after a seek reads
+// little more than it needs. Blocks already in the cache are used, but
+// blocks read here are not added to it. A block that cannot be read or
+// decoded ends the iteration with ok() false.
+class SSTable::Iterator : public KVIterator {
+public:
+    explicit Iterator(const SSTable &table, RateLimiter *limiter = nullptr);
+
+    bool valid() const override;
+    void seekToFirst() override;
+    void seek(std::string_view target) override;
+    void next() override;
+    std::string_view key() const override;
+    const DBEntry &entry() const override;
+    bool ok() const override;
+
+private:
+    const SSTable &table_;
+    RateLimiter *limiter_;
+    // Index of the loaded block; table_.index_.size() once exhausted.
+    size_t block_;
+    BlockCache::Block data_;
+    BlockIterator iter_;
+    DBEntry entry_;
+    // Raw file bytes starting at readaheadOffset_.
+    std::string readahead_;
+    uint64_t readaheadOffset_ = 0;
+    size_t readaheadWindow_ = 0;
+    bool sequential_ = false;
+    bool failed_ = false;
+
+    // Loads `block` and positions at its first record.
+    void loadBlock(size_t block);
+    BlockCache::Block fetchBlock(BlockHandle handle);
+    // Moves to the next non-empty block once the current one is used up.
+    void skipEmptyBlocks();
+    // Ends the iteration after a read error.
+    void fail();
 };
 
 } // namespace DB
@@ -0,0 +1,141 @@
+#include "sstable_builder.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include "../configs/db_config.hpp"
+#include "../bloom/bloom.hpp"
+#include "../bloom/filter.hpp"
+#include "../crc32c/crc32c.hpp"
+#include "compression.hpp"
+#include "footer.hpp"
+
+namespace DB {
+
+namespace {
+
+// fsyncs a file or directory by path.
+bool syncPath(const std::string &path, int flags) {
+    int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+}  // namespace
+
+SSTableBuilder::SSTableBuilder(
+    const std::string &filename,
+    RateLimiter *limiter,
+    FilterType filterType,
+    PrefixExtractor prefixExtractor
+)
+    : filename_(filename),
+      limiter_(limiter),
+      filterType_(filterType),
+      prefixExtractor_(prefixExtractor),
+      out_(filename, std::ios::binary | std::ios::trunc),
+      block_(DBConfig::kBlockRestartInterval) {
+    if (!out_) {
+        throw std::runtime_error("Cannot open SSTable for write: " + filename);
+    }
+}
+
+SSTableBuilder::~SSTableBuilder() {
+    if (!finished_) {
+        out_.close();
+        std::error_code ec;
+        std::filesystem::remove(filename_, ec);
+    }
+}
+
+void SSTableBuilder::add(std::string_view key, const DBEntry &entry) {
+    auto prefix = prefixExtractor_.extract(key);
+    if (entries_ == 0) {
+        index_.setFirstKey(key);
+    }
+    // Keys arrive sorted, so keys sharing a prefix are adjacent.
+    if (prefix && (entries_ == 0 ||
+                   prefixExtractor_.extract(lastKey_) != prefix)) {
+        hashes_.push_back(KeyFilter::prefixHash(*prefix));
+    }
+    hashes_.push_back(KeyFilter::keyHash(key));
+    ++entries_;
+    block_.add(key, entry);
+    lastKey_.assign(key.data(), key.size());
+    if (block_.size() >= DBConfig::kSstableBlockSize) {
+        finishBlock();
+    }
+}
+
+void SSTableBuilder::finishBlock() {
+    stored_.clear();
+    encodeBlock(
+        block_.finish(), DBConfig::kSstableCompression,
+        DBConfig::kSstableCompressionLevel, stored_
+    );
+    if (limiter_) {
+        limiter_->request(stored_.size());
+    }
+    out_.write(stored_.data(), static_cast<std::streamsize>(stored_.size()));
+    index_.add(
+        lastKey_, BlockHandle{offset_, static_cast<uint32_t>(stored_.size())}
+    );
+    offset_ += stored_.size();
+    block_.reset();
+}
+
+void SSTableBuilder::finish() {
+    if (!block_.empty()) {
+        finishBlock();
+    }
+
+    double bitsPerKey = DBConfig::kFilterTargetFpr > 0
+                            ? BloomFilter::bitsPerKeyForFpr(
+                                  DBConfig::kFilterTargetFpr
+                              )
+                            : DBConfig::kFilterBitsPerKey;
+    auto filter = buildFilter(filterType_, hashes_, bitsPerKey);
+    std::vector<uint64_t>().swap(hashes_);
+    std::string meta;
+    filter->encodeTo(meta);
+
+    Footer footer;
+    footer.filterType = filter->type();
+    footer.prefixExtractor = prefixExtractor_.id();
+    footer.filter = BlockHandle{offset_, static_cast<uint32_t>(meta.size())};
+    footer.filterCrc = crc32c::mask(crc32c::value(meta.data(), meta.size()));
+    index_.encodeTo(meta);
+    footer.index = BlockHandle{
+        offset_ + footer.filter.size,
+        static_cast<uint32_t>(meta.size() - footer.filter.size)};
+    footer.indexCrc = crc32c::mask(
+        crc32c::value(meta.data() + footer.filter.size, footer.index.size)
+    );
+    footer.encodeTo(meta);
+    if (limiter_) {
+        limiter_->request(meta.size());
+    }
+    out_.write(meta.data(), static_cast<std::streamsize>(meta.size()));
+
+    out_.flush();
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("Cannot write SSTable: " + filename_);
+    }
+
+    // The table must be durable, including its directory entry, before the
+    // WAL segments or tables it replaces are deleted.
+    auto parent = std::filesystem::path(filename_).parent_path().string();
+    if (!syncPath(filename_, O_RDONLY) ||
+        !syncPath(parent.empty() ? "." : parent, O_RDONLY | O_DIRECTORY)) {
+        throw std::runtime_error("Cannot sync SSTable: " + filename_);
+    }
+    finished_ = true;
+}
+
+}  // namespace DB
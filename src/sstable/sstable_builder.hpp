@@ -0,0 +1,82 @@
+#ifndef SSTABLE_BUILDER_HPP_
+#define SSTABLE_BUILDER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../base/db_entry.hpp"
+#include "../configs/db_config.hpp"
+#include "../bloom/filter_type.hpp"
+#include "../bloom/prefix_extractor.hpp"
+#include "../ratelimiter/rate_limiter.hpp"
+#include "block.hpp"
+#include "block_index.hpp"
+
+namespace DB {
+
+// Writes a table file incrementally from entries added in strictly
+// increasing key order. Memory use is one data block, the block index and
+// 8 bytes of filter hash per key and per distinct key prefix, independent of
+// value sizes.
+class SSTableBuilder {
+public:
+    // Every write is charged to `limiter` when one is given. The default
+    // filter is the one configured for level 0, where flushes go; the
+    // filter also holds the prefixes `prefixExtractor` extracts.
+    explicit SSTableBuilder(
+        const std::string &filename,
+        RateLimiter *limiter = nullptr,
+        FilterType filterType = DBConfig::kFilterTypeByLevel[0],
+        PrefixExtractor prefixExtractor = DBConfig::kPrefixExtractor
+    );
+    // Removes the file unless finish() succeeded.
+    ~SSTableBuilder();
+
+    SSTableBuilder(const SSTableBuilder &) = delete;
+    SSTableBuilder &operator=(const SSTableBuilder &) = delete;
+
+    void add(std::string_view key, const DBEntry &entry);
+
+    size_t entries() const {
+        return entries_;
+    }
+
+    // Bytes of data blocks written so far.
+    uint64_t fileSize() const {
+        return offset_;
+    }
+
+    // Writes the filter, index and footer and syncs the file and its
+    // directory entry. Throws on I/O errors.
+    void finish();
+
+    const std::string &filename() const {
+        return filename_;
+    }
+
+private:
+    std::string filename_;
+    RateLimiter *limiter_;
+    FilterType filterType_;
+    PrefixExtractor prefixExtractor_;
+    std::ofstream out_;
+    BlockBuilder block_;
+    BlockIndex index_;
+    std::string lastKey_;
+    std::string stored_;
+    uint64_t offset_ = 0;
+    size_t entries_ = 0;
+    // Key hashes, plus one prefix hash per distinct prefix.
+    std::vector<uint64_t> hashes_;
+    bool finished_ = false;
+
+    void finishBlock();
+};
+
+}  // namespace DB
+
+#endif  // SSTABLE_BUILDER_HPP_
@@ -0,0 +1,295 @@
+#include "sstable.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <userver/fs/blocking/temp_directory.hpp>
+#include <userver/utest/utest.hpp>
+#include "../ratelimiter/rate_limiter.hpp"
+#include "sstable_builder.hpp"
+
+namespace DB {
+
+namespace {
+
+constexpr int kTenants = 50;
+constexpr int kKeysPerTenant = 20;
+
+std::string tenant(int t) {
+    return "tenant" + std::to_string(t) + ":";
+}
+
+std::string key(int t, int i) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%05d", i);
+    return tenant(t) + buf;
+}
+
+// Tenants 0, 2, 4, ... so the odd ones fall between stored keys.
+std::unique_ptr<SSTable> writeTenants(
+    const std::string &path,
+    PrefixExtractor extractor
+) {
+    SSTableBuilder builder(path, nullptr, FilterType::kBloom, extractor);
+    std::vector<std::string> keys;
+    for (int t = 0; t < kTenants; t += 2) {
+        for (int i = 0; i < kKeysPerTenant; ++i) {
+            keys.push_back(key(t, i));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    for (const auto &k : keys) {
+        builder.add(k, DBEntry{{k.begin(), k.end()}, false});
+    }
+    builder.finish();
+    return std::make_unique<SSTable>(path);
+}
+
+constexpr size_t kStrangers = 500;
+
+// How many of kStrangers prefixes that no stored key starts with get
+// through the table's filter.
+size_t strangersPassed(const SSTable &table, const PrefixExtractor &extractor) {
+    size_t passed = 0;
+    for (size_t i = 0; i < kStrangers; ++i) {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "n%07zu:", i);
+        passed += table.mayContainPrefix(extractor, buf);
+    }
+    return passed;
+}
+
+// Enough rows of kRowValue bytes to need several full-size readahead
+// windows.
+constexpr int kRows = 12000;
+constexpr size_t kRowValue = 200;
+
+std::string row(int i) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "row%06d", i);
+    return buf;
+}
+
+// Incompressible, so blocks keep their size on disk.
+std::vector<uint8_t> rowValue(int i) {
+    std::vector<uint8_t> bytes(kRowValue);
+    uint64_t x = 0x9e3779b97f4a7c15ull * static_cast<uint64_t>(i + 1);
+    for (auto &b : bytes) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        b = static_cast<uint8_t>(x);
+    }
+    return bytes;
+}
+
+std::unique_ptr<SSTable> writeRows(const std::string &path) {
+    SSTableBuilder builder(path);
+    for (int i = 0; i < kRows; ++i) {
+        builder.add(row(i), DBEntry{rowValue(i), false});
+    }
+    builder.finish();
+    return std::make_unique<SSTable>(path);
+}
+
+// Counts the bytes an iterator reads: every readahead refill is charged to
+// the limiter, which does no limiting at a zero rate.
+class ReadTracker {
+public:
+    RateLimiter limiter{0, 0, 0, std::chrono::microseconds(0)};
+
+    // Bytes read since the previous call.
+    uint64_t take() {
+        uint64_t total = limiter.stats().bytes;
+        uint64_t read = total - seen_;
+        seen_ = total;
+        return read;
+    }
+
+private:
+    uint64_t seen_ = 0;
+};
+
+}  // namespace
+
+TEST(SSTable, PrefixFilterRulesOutMissingPrefixes) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto extractor = PrefixExtractor::delimited(':');
+    auto table = writeTenants(dir.GetPath() + "/t.dat", extractor);
+
+    size_t falsePositives = 0;
+    for (int t = 0; t < kTenants; ++t) {
+        bool present = t % 2 == 0;
+        bool answer = table->mayContainPrefix(extractor, tenant(t));
+        if (present) {
+            EXPECT_TRUE(answer) << tenant(t);
+        } else {
+            falsePositives += answer;
+        }
+    }
+    // 25 absent tenants against a filter of 10 bits per key.
+    EXPECT_LE(falsePositives, 2u);
+    // Longer prefixes are checked by the prefix they extract to.
+    EXPECT_TRUE(table->mayContainPrefix(extractor, key(4, 7)));
+    EXPECT_LE(strangersPassed(*table, extractor), 10u);
+}
+
+TEST(SSTable, ShortPrefixesAreNotFiltered) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto extractor = PrefixExtractor::delimited(':');
+    auto table = writeTenants(dir.GetPath() + "/t.dat", extractor);
+    // "nobody" extracts to nothing, so the filter cannot answer for it.
+    EXPECT_TRUE(table->mayContainPrefix(extractor, "nobody"));
+    EXPECT_TRUE(table->mayContainPrefix(extractor, ""));
+}
+
+TEST(SSTable, PrefixFilterNeedsTheSameExtractor) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto table = writeTenants(
+        dir.GetPath() + "/t.dat", PrefixExtractor::delimited(':')
+    );
+    ASSERT_LE(strangersPassed(*table, PrefixExtractor::delimited(':')), 10u);
+    // The filter holds prefixes of another shape, so any other extractor
+    // gets a conservative answer.
+    EXPECT_EQ(strangersPassed(*table, PrefixExtractor::fixed(9)), kStrangers);
+    EXPECT_EQ(strangersPassed(*table, PrefixExtractor::none()), kStrangers);
+}
+
+TEST(SSTable, TablesWithoutPrefixesAreNotFiltered) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto table =
+        writeTenants(dir.GetPath() + "/t.dat", PrefixExtractor::none());
+    EXPECT_EQ(
+        strangersPassed(*table, PrefixExtractor::delimited(':')), kStrangers
+    );
+    EXPECT_EQ(strangersPassed(*table, PrefixExtractor::none()), kStrangers);
+}
+
+TEST(SSTable, FixedPrefixFilter) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto extractor = PrefixExtractor::fixed(8);
+    auto table = writeTenants(dir.GetPath() + "/t.dat", extractor);
+    // "tenant4:" and "tenant10" are both 8-byte prefixes of stored keys.
+    EXPECT_TRUE(table->mayContainPrefix(extractor, "tenant4:"));
+    EXPECT_TRUE(table->mayContainPrefix(extractor, "tenant10"));
+    EXPECT_LE(strangersPassed(*table, extractor), 10u);
+}
+
+TEST(SSTable, SeekThenScanAcrossBlocks) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto table = writeRows(dir.GetPath() + "/t.dat");
+    const auto &index = table->GetIndex();
+    ASSERT_GT(index.size(), 100u);
+
+    // Land inside a block in the middle, then read on through the next few
+    // block boundaries.
+    constexpr int kMiddle = kRows / 2 + 3;
+    size_t firstBlock = index.find(row(kMiddle));
+    ASSERT_NE(index.lastKey(firstBlock), row(kMiddle));
+    auto it = table->newIterator();
+    it->seek(row(kMiddle));
+    int i = kMiddle;
+    size_t endBlock = firstBlock + 4;
+    for (; it->valid() && index.find(row(i)) < endBlock; it->next(), ++i) {
+        ASSERT_EQ(it->key(), row(i));
+        ASSERT_EQ(it->entry().value, rowValue(i)) << row(i);
+    }
+    EXPECT_TRUE(it->ok());
+    EXPECT_EQ(index.find(row(i)), endBlock);
+
+    // A target between two keys lands on the next one, also when that one
+    // starts the next block.
+    it->seek(row(kMiddle) + "x");
+    ASSERT_TRUE(it->valid());
+    EXPECT_EQ(it->key(), row(kMiddle + 1));
+    std::string blockEnd(index.lastKey(firstBlock));
+    it->seek(blockEnd + "x");
+    ASSERT_TRUE(it->valid());
+    EXPECT_EQ(index.find(std::string(it->key())), firstBlock + 1);
+    EXPECT_GT(it->key(), blockEnd);
+
+    it->seek("a");
+    ASSERT_TRUE(it->valid());
+    EXPECT_EQ(it->key(), row(0));
+    it->seek("z");
+    EXPECT_FALSE(it->valid());
+    EXPECT_TRUE(it->ok());
+}
+
+TEST(SSTable, FullScanReturnsEveryRow) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto table = writeRows(dir.GetPath() + "/t.dat");
+    auto it = table->newIterator();
+    int i = 0;
+    for (it->seekToFirst(); it->valid(); it->next(), ++i) {
+        ASSERT_EQ(it->key(), row(i));
+        ASSERT_EQ(it->entry().value, rowValue(i)) << row(i);
+    }
+    EXPECT_TRUE(it->ok());
+    EXPECT_EQ(i, kRows);
+}
+
+UTEST(SSTable, ReadaheadGrowsWhileSequential) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto table = writeRows(dir.GetPath() + "/t.dat");
+    const auto &index = table->GetIndex();
+    ReadTracker reads;
+    auto it = table->newIterator(&reads.limiter);
+
+    // The first read after positioning is just the block needed.
+    it->seekToFirst();
+    EXPECT_EQ(reads.take(), index.handle(0).size);
+
+    // Each later refill doubles the window, from four blocks up to the
+    // configured maximum; the last one stops at the end of the data.
+    std::vector<uint64_t> refills;
+    for (; it->valid(); it->next()) {
+        if (uint64_t read = reads.take()) {
+            refills.push_back(read);
+        }
+    }
+    EXPECT_TRUE(it->ok());
+    ASSERT_GE(refills.size(), 3u);
+    uint64_t window = DBConfig::kSstableBlockSize * 4;
+    for (size_t i = 0; i + 1 < refills.size(); ++i) {
+        EXPECT_EQ(refills[i], window) << i;
+        window = std::min<uint64_t>(window * 2, DBConfig::kIteratorReadahead);
+    }
+    EXPECT_LE(refills.back(), window);
+    EXPECT_EQ(refills[refills.size() - 2], DBConfig::kIteratorReadahead);
+}
+
+UTEST(SSTable, ReadaheadRestartsAfterSeek) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    auto table = writeRows(dir.GetPath() + "/t.dat");
+    const auto &index = table->GetIndex();
+    ReadTracker reads;
+    auto it = table->newIterator(&reads.limiter);
+
+    // Grow the window over a few refills.
+    it->seekToFirst();
+    size_t refills = 0;
+    for (; it->valid() && refills < 4; it->next()) {
+        refills += reads.take() > 0;
+    }
+    ASSERT_EQ(refills, 4u);
+
+    // A seek far outside the buffer reads only its block...
+    constexpr int kTarget = kRows - 2000;
+    size_t block = index.find(row(kTarget));
+    it->seek(row(kTarget));
+    ASSERT_TRUE(it->valid());
+    EXPECT_EQ(it->key(), row(kTarget));
+    EXPECT_EQ(reads.take(), index.handle(block).size);
+
+    // ...and the window starts growing again from four blocks.
+    uint64_t read = 0;
+    for (; it->valid() && read == 0; it->next()) {
+        read = reads.take();
+    }
+    EXPECT_EQ(read, DBConfig::kSstableBlockSize * 4);
+}
+
+}  // namespace DB
@@ -1,149 +1,477 @@
 #include "wal.hpp"
 #include <fcntl.h>
 #include <unistd.h>
-#include <boost/iostreams/device/file_descriptor.hpp>
-#include <boost/iostreams/stream.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
 #include <filesystem>
-#include <iostream>
-#include <sstream>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <userver/logging/log.hpp>
+#include <utility>
+#include "../crc32c/crc32c.hpp"
 
 namespace DB {
 
-WAL::WAL(const std::string &filename)
-    : filename_(filename), fd_out_(-1), out_(nullptr) {
-    std::filesystem::create_directories(
-        std::filesystem::path(filename_).parent_path()
-    );
+namespace {
 
-    fd_out_ = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
-    if (fd_out_ >= 0) {
-        out_ = std::make_unique<boost_file_sink>(
-            fd_out_, boost::iostreams::never_close_handle
-        );
-    }
-}
+// Record framing: [masked crc32c:4][length:4][payload:length]. The CRC
+// covers the length field and the payload, so a corrupted length is caught
+// before it is trusted. Payload: [op:1][keySize:4][key] and, for inserts,
+// [valueSize:4][value].
+constexpr size_t kHeaderSize = 8;
+constexpr uint8_t kOpInsert = 1;
+constexpr uint8_t kOpRemove = 2;
 
-WAL::~WAL() {
-    if (fd_out_ >= 0) {
-        ::close(fd_out_);
-    }
+void appendRaw(std::string &buf, const void *data, size_t size) {
+    buf.append(static_cast<const char *>(data), size);
 }
 
-void WAL::logInsert(
-    const std::string &key,
-    const std::vector<uint8_t> &valueBlob
-) {
-    std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+// Reserves a record header in `buf` and returns its offset.
+size_t beginRecord(std::string &buf) {
+    size_t start = buf.size();
+    buf.append(kHeaderSize, '\0');
+    return start;
+}
 
-    if (out_) {
-        uint8_t op = 1;
-        uint32_t keySize = static_cast<uint32_t>(key.size());
-        uint32_t valueSize = static_cast<uint32_t>(valueBlob.size());
+void finishRecord(std::string &buf, size_t start) {
+    uint32_t length = static_cast<uint32_t>(buf.size() - start - kHeaderSize);
+    std::memcpy(&buf[start + 4], &length, sizeof(length));
+    uint32_t crc = crc32c::mask(
+        crc32c::value(buf.data() + start + 4, buf.size() - start - 4)
+    );
+    std::memcpy(&buf[start], &crc, sizeof(crc));
+}
 
-        out_->write(reinterpret_cast<const char *>(&op), sizeof(op));
+uint32_t readU32(const char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
 
-        out_->write(reinterpret_cast<const char *>(&keySize), sizeof(keySize));
-        out_->write(key.data(), keySize);
+// Read-only mapping of a whole file; empty if the file is empty or cannot
+// be mapped.
+class MappedFile {
+public:
+    explicit MappedFile(int fd) {
+        struct stat st {};
+        if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+            return;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            size_ = 0;
+            return;
+        }
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(p);
+    }
 
-        out_->write(
-            reinterpret_cast<const char *>(&valueSize), sizeof(valueSize)
-        );
-        if (valueSize > 0) {
-            out_->write(
-                reinterpret_cast<const char *>(valueBlob.data()), valueSize
-            );
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(const_cast<char *>(data_), size_);
         }
-        out_->flush();
     }
-}
 
-void WAL::logRemove(const std::string &key) {
-    std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
 
-    if (out_) {
-        uint8_t op = 2;
-        uint32_t keySize = static_cast<uint32_t>(key.size());
-        out_->write(reinterpret_cast<const char *>(&op), sizeof(op));
-        out_->write(reinterpret_cast<const char *>(&keySize), sizeof(keySize));
-        out_->write(key.data(), keySize);
-        out_->flush();
+    std::string_view view() const {
+        return data_ ? std::string_view(data_, size_) : std::string_view();
+    }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Segment number from a `wal_<N>.log` file name.
+std::optional<uint64_t> parseSegmentName(const std::string &name) {
+    constexpr std::string_view kPrefix = "wal_";
+    constexpr std::string_view kSuffix = ".log";
+    if (name.size() <= kPrefix.size() + kSuffix.size() ||
+        name.compare(0, kPrefix.size(), kPrefix) != 0 ||
+        name.compare(name.size() - kSuffix.size(), kSuffix.size(), kSuffix) !=
+            0) {
+        return std::nullopt;
+    }
+    // Signs, spaces and out-of-range numbers are rejected, so such a file
+    // is left alone rather than replayed.
+    const char *begin = name.data() + kPrefix.size();
+    const char *end = name.data() + name.size() - kSuffix.size();
+    uint64_t segment = 0;
+    auto [ptr, ec] = std::from_chars(begin, end, segment);
+    if (ec != std::errc() || ptr != end) {
+        return std::nullopt;
     }
+    return segment;
 }
 
-void WAL::recover(
-    std::function<void(const std::string &, const std::vector<uint8_t> &, bool)>
-        applyOperation
+// Replays one segment into `stats`. Returns the length of its valid
+// prefix if a torn or corrupt record ends it early.
+std::optional<uint64_t> replaySegment(
+    const std::string &path,
+    const std::function<void(std::string &&, std::vector<uint8_t> &&, bool)>
+        &applyOperation,
+    WAL::RecoveryStats &stats
 ) {
-    int fd = ::open(filename_.c_str(), O_RDONLY);
+    // Skipping a segment would replay the ones after it across a gap.
+    int fd = ::open(path.c_str(), O_RDONLY);
     if (fd < 0) {
-        return;
+        throw std::runtime_error("Cannot open WAL segment: " + path);
     }
+    // Records are parsed straight out of the page cache; only keys and
+    // values are copied, into the memtable.
+    std::optional<MappedFile> mapped(std::in_place, fd);
+    std::string_view data = mapped->view();
 
-    boost::iostreams::stream<boost::iostreams::file_descriptor_source> in(
-        fd, boost::iostreams::close_handle
-    );
-
-    while (!in.eof()) {
-        uint8_t opType = 0;
-        in.read(reinterpret_cast<char *>(&opType), sizeof(opType));
-        if (!in || in.gcount() != sizeof(opType)) {
+    size_t pos = 0;
+    while (data.size() - pos >= kHeaderSize) {
+        const char *rec = data.data() + pos;
+        uint32_t length = readU32(rec + 4);
+        if (length > data.size() - pos - kHeaderSize) {
+            break;
+        }
+        uint32_t expected = crc32c::unmask(readU32(rec));
+        if (crc32c::value(rec + 4, length + 4) != expected) {
             break;
         }
 
-        uint32_t keySize = 0;
-        in.read(reinterpret_cast<char *>(&keySize), sizeof(keySize));
-        if (!in || in.gcount() != sizeof(keySize)) {
+        const char *p = rec + kHeaderSize;
+        const char *end = p + length;
+        if (end - p < 5) {
             break;
         }
-        std::string key(keySize, '\0');
-        in.read(&key[0], keySize);
-        if (!in || in.gcount() != static_cast<std::streamsize>(keySize)) {
+        uint8_t op = static_cast<uint8_t>(*p++);
+        uint32_t keySize = readU32(p);
+        p += 4;
+        if (static_cast<size_t>(end - p) < keySize) {
             break;
         }
-
-        if (opType == 1) {
-            uint32_t valueSize = 0;
-            in.read(reinterpret_cast<char *>(&valueSize), sizeof(valueSize));
-            if (!in || in.gcount() != sizeof(valueSize)) {
+        std::string key(p, keySize);
+        p += keySize;
+        if (op == kOpInsert) {
+            if (end - p < 4) {
                 break;
             }
-            std::vector<uint8_t> blob(valueSize);
-            if (valueSize > 0) {
-                in.read(reinterpret_cast<char *>(blob.data()), valueSize);
-                if (!in ||
-                    in.gcount() != static_cast<std::streamsize>(valueSize)) {
-                    break;
-                }
+            uint32_t valueSize = readU32(p);
+            p += 4;
+            if (static_cast<size_t>(end - p) != valueSize) {
+                break;
             }
-            applyOperation(key, blob, false);
-        } else if (opType == 2) {
-            std::vector<uint8_t> emptyBlob;
-            applyOperation(key, emptyBlob, true);
+            applyOperation(
+                std::move(key), std::vector<uint8_t>(p, end), false
+            );
+        } else if (op == kOpRemove && p == end) {
+            applyOperation(std::move(key), {}, true);
         } else {
             break;
         }
+        ++stats.records;
+        pos += kHeaderSize + length;
+    }
+
+    stats.validBytes += pos;
+    stats.discardedBytes += data.size() - pos;
+    bool torn = pos < data.size();
+    mapped.reset();
+    ::close(fd);
+    if (torn) {
+        return pos;
     }
+    return std::nullopt;
 }
 
-void WAL::clear() {
-    std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+}  // namespace
+
+WAL::WAL(
+    const std::string &directory,
+    WalSyncMode mode,
+    std::chrono::milliseconds syncInterval
+)
+    : directory_(directory), mode_(mode), fd_out_(-1) {
+    std::filesystem::create_directories(directory_);
+    for (const auto &entry : std::filesystem::directory_iterator(directory_)) {
+        auto segment = parseSegmentName(entry.path().filename().string());
+        if (segment && entry.is_regular_file()) {
+            recoverable_.push_back(*segment);
+        }
+    }
+    std::sort(recoverable_.begin(), recoverable_.end());
+    if (!recoverable_.empty()) {
+        oldestSegment_ = recoverable_.front();
+        segment_ = recoverable_.back() + 1;
+    }
+    openForAppend();
+    if (mode_ == WalSyncMode::kFsyncPeriodic) {
+        syncTask_.Start(
+            "wal-sync", userver::utils::PeriodicTask::Settings(syncInterval),
+            [this] { syncIfDirty(); }
+        );
+    }
+}
 
+WAL::~WAL() {
+    syncTask_.Stop();
     if (fd_out_ >= 0) {
+        if (mode_ != WalSyncMode::kNone && mode_ != WalSyncMode::kOsBuffered) {
+            ::fdatasync(fd_out_);
+        }
         ::close(fd_out_);
     }
+}
 
-    int fd_clear =
-        ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (fd_clear >= 0) {
-        ::close(fd_clear);
+std::string WAL::segmentPath(uint64_t segment) const {
+    return directory_ + "/wal_" + std::to_string(segment) + ".log";
+}
+
+void WAL::openForAppend() {
+    fd_out_ = ::open(
+        segmentPath(segment_).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644
+    );
+    // Make the new segment's directory entry durable before records in it
+    // are acknowledged.
+    if (fd_out_ >= 0 && mode_ != WalSyncMode::kNone &&
+        mode_ != WalSyncMode::kOsBuffered) {
+        syncDirectory();
     }
+}
+
+void WAL::syncDirectory() {
+    int fd = ::open(directory_.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+uint64_t WAL::appendInsert(
+    const std::string &key,
+    const std::vector<uint8_t> &valueBlob
+) {
+    std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+    checkNotFailed();
+    if (mode_ != WalSyncMode::kNone) {
+        uint8_t op = kOpInsert;
+        uint32_t keySize = static_cast<uint32_t>(key.size());
+        uint32_t valueSize = static_cast<uint32_t>(valueBlob.size());
+        size_t start = beginRecord(pending_);
+        appendRaw(pending_, &op, sizeof(op));
+        appendRaw(pending_, &keySize, sizeof(keySize));
+        appendRaw(pending_, key.data(), keySize);
+        appendRaw(pending_, &valueSize, sizeof(valueSize));
+        appendRaw(pending_, valueBlob.data(), valueSize);
+        finishRecord(pending_, start);
+    }
+    return ++lastSeq_;
+}
+
+uint64_t WAL::appendRemove(const std::string &key) {
+    std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+    checkNotFailed();
+    if (mode_ != WalSyncMode::kNone) {
+        uint8_t op = kOpRemove;
+        uint32_t keySize = static_cast<uint32_t>(key.size());
+        size_t start = beginRecord(pending_);
+        appendRaw(pending_, &op, sizeof(op));
+        appendRaw(pending_, &keySize, sizeof(keySize));
+        appendRaw(pending_, key.data(), keySize);
+        finishRecord(pending_, start);
+    }
+    return ++lastSeq_;
+}
+
+void WAL::commit(uint64_t seq) {
+    std::unique_lock<userver::engine::Mutex> lock(walMutex_);
+    while (writtenSeq_ < seq && !failed_) {
+        if (leaderActive_) {
+            batchWritten_.Wait(lock);
+            continue;
+        }
+        leaderActive_ = true;
+        std::string batch;
+        batch.swap(pending_);
+        uint64_t batchSeq = lastSeq_;
+        lock.unlock();
+        bool ok = writeBatch(batch);
+        lock.lock();
+        leaderActive_ = false;
+        writtenSeq_ = batchSeq;
+        failed_ = failed_ || !ok;
+        unsynced_ = unsynced_ || mode_ == WalSyncMode::kFsyncPeriodic;
+        batchWritten_.NotifyAll();
+    }
+    checkNotFailed();
+}
+
+void WAL::checkNotFailed() const {
+    // After a failed write or sync the tail of the log is unknown, so no
+    // later record can be acknowledged either.
+    if (failed_) {
+        throw std::runtime_error("WAL write failed in " + directory_);
+    }
+}
+
+bool WAL::writeBatch(const std::string &batch) {
+    if (batch.empty()) {
+        return true;
+    }
+    if (fd_out_ < 0) {
+        return false;
+    }
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    const char *data = batch.data();
+    size_t left = batch.size();
+    while (left > 0) {
+        ssize_t n = ::write(fd_out_, data, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+    }
+    return mode_ != WalSyncMode::kFsyncPerBatch || sync(fd_out_);
+}
+
+bool WAL::sync(int fd) {
+    syncs_.fetch_add(1, std::memory_order_relaxed);
+    return ::fdatasync(fd) == 0;
+}
+
+void WAL::syncIfDirty() {
+    int fd = -1;
+    {
+        std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+        if (!unsynced_ || leaderActive_) {
+            return;
+        }
+        // A private descriptor, since rotate() may close fd_out_ meanwhile.
+        fd = fd_out_ >= 0 ? ::dup(fd_out_) : -1;
+        if (fd < 0) {
+            // Retried on the next tick.
+            return;
+        }
+        unsynced_ = false;
+    }
+    bool ok = sync(fd);
+    int error = errno;
+    ::close(fd);
+    if (!ok) {
+        LOG_ERROR() << "WAL sync failed in " << directory_ << ": "
+                    << std::strerror(error);
+        std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+        failed_ = true;
+    }
+}
+
+uint64_t WAL::rotate() {
+    std::unique_lock<userver::engine::Mutex> lock(walMutex_);
+    batchWritten_.Wait(lock, [this] { return !leaderActive_; });
+    // Pending records belong to the memtable being sealed, so they go to the
+    // segment being closed. Appenders are blocked meanwhile, which is fine:
+    // the database rotates with db_mutex held anyway.
+    bool ok = !failed_ && writeBatch(pending_);
+    if (ok && unsynced_) {
+        ok = sync(fd_out_);
+    }
+    pending_.clear();
+    unsynced_ = false;
+    writtenSeq_ = lastSeq_;
+    failed_ = failed_ || !ok;
+    batchWritten_.NotifyAll();
 
-    fd_out_ = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
     if (fd_out_ >= 0) {
-        out_.reset(
-            new boost_file_sink(fd_out_, boost::iostreams::never_close_handle)
-        );
+        ::close(fd_out_);
+    }
+    uint64_t closed = segment_++;
+    // If this fails, the next commit fails and poisons the log.
+    openForAppend();
+    return closed;
+}
+
+void WAL::removeSegmentsUpTo(uint64_t segment) {
+    std::lock_guard<userver::engine::Mutex> lock(walMutex_);
+    if (segment >= segment_) {
+        throw std::logic_error("Cannot remove the active WAL segment");
+    }
+    bool removed = false;
+    for (; oldestSegment_ <= segment; ++oldestSegment_) {
+        std::error_code ec;
+        removed = std::filesystem::remove(segmentPath(oldestSegment_), ec) ||
+                  removed;
+    }
+    // A segment that reappears after a crash would replay stale records
+    // over newer SSTables.
+    if (removed) {
+        syncDirectory();
+    }
+}
+
+WAL::Stats WAL::stats() const {
+    Stats s;
+    s.batches = batches_.load(std::memory_order_relaxed);
+    s.syncs = syncs_.load(std::memory_order_relaxed);
+    return s;
+}
+
+WAL::RecoveryStats WAL::recover(
+    std::function<void(std::string &&, std::vector<uint8_t> &&, bool)>
+        applyOperation
+) {
+    RecoveryStats stats;
+    for (size_t i = 0; i < recoverable_.size(); ++i) {
+        auto path = segmentPath(recoverable_[i]);
+        size_t before = stats.records;
+        auto validLength = replaySegment(path, applyOperation, stats);
+        ++stats.segments;
+        if (validLength) {
+            // Later records were logged after the lost ones and cannot be
+            // applied without them, so replay ends here. The later segments
+            // are removed durably before this one is truncated: otherwise a
+            // crash in between could leave a clean-looking segment followed
+            // by them.
+            for (size_t j = i + 1; j < recoverable_.size(); ++j) {
+                auto later = segmentPath(recoverable_[j]);
+                std::error_code ec;
+                auto size = std::filesystem::file_size(later, ec);
+                stats.discardedBytes += ec ? 0 : size;
+                ++stats.droppedSegments;
+                if (!std::filesystem::remove(later, ec) && ec) {
+                    throw std::runtime_error(
+                        "Cannot remove WAL segment: " + later
+                    );
+                }
+            }
+            if (stats.droppedSegments > 0) {
+                syncDirectory();
+            }
+            // Drop the torn or corrupt tail so it is not mistaken for data
+            // later.
+            if (::truncate(path.c_str(), static_cast<off_t>(*validLength)) !=
+                0) {
+                throw std::runtime_error(
+                    "Cannot truncate WAL segment: " + path
+                );
+            }
+        }
+        if (stats.records == before) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+        if (validLength) {
+            break;
+        }
     }
+    recoverable_.clear();
+    return stats;
 }
 
 }  // namespace DB
@@ -1,39 +1,117 @@
 #ifndef WAL_HPP_
 #define WAL_HPP_
 
-#include <boost/iostreams/device/file_descriptor.hpp>
-#include <boost/iostreams/stream.hpp>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <string>
+#include <userver/engine/condition_variable.hpp>
 #include <userver/engine/mutex.hpp>
+#include <userver/utils/periodic_task.hpp>
 #include <vector>
+#include "wal_sync_mode.hpp"
 
 namespace DB {
-using boost_file_sink =
-    boost::iostreams::stream<boost::iostreams::file_descriptor_sink>;
 
+// Write-ahead log with group commit, split into numbered segment files
+// (`wal_<N>.log`) in the database directory.
+//
+// Writers append records to an in-memory batch and get a sequence number
+// back, then call commit() with it. The first committer to arrive becomes
+// the leader and writes everything batched so far with one write() (and one
+// fdatasync, depending on the mode); the others wait for it.
+//
+// The database rotates to a new segment whenever it seals a memtable, so
+// each sealed memtable is covered by the segments up to the one rotate()
+// returned, and those can be removed once its SSTable is durable.
 class WAL {
 public:
-    WAL(const std::string &filename);
+    WAL(const std::string &directory,
+        WalSyncMode mode = WalSyncMode::kFsyncPerBatch,
+        std::chrono::milliseconds syncInterval = std::chrono::milliseconds(100
+        ));
     ~WAL();
 
-    void
-    logInsert(const std::string &key, const std::vector<uint8_t> &valueBlob);
-    void logRemove(const std::string &key);
+    // Callers must append in the same order they apply changes to the
+    // memtable. Both throw, appending nothing, once a write or sync of the
+    // log has failed. Sequence numbers are consecutive from 1.
+    uint64_t
+    appendInsert(const std::string &key, const std::vector<uint8_t> &valueBlob);
+    uint64_t appendRemove(const std::string &key);
+    // Blocks until the record `seq` is durable according to the sync mode.
+    void commit(uint64_t seq);
 
-    void recover(std::function<
-                 void(const std::string &, const std::vector<uint8_t> &, bool)>
-                     applyOperation);
+    // Writes out pending records, closes the active segment and starts a new
+    // one. Returns the number of the closed segment.
+    uint64_t rotate();
+    // Deletes every segment numbered `segment` or lower.
+    void removeSegmentsUpTo(uint64_t segment);
 
-    void clear();
+    struct Stats {
+        // Non-empty batches written; each covers every record appended
+        // before its leader took over.
+        uint64_t batches = 0;
+        // fdatasync calls on segment files.
+        uint64_t syncs = 0;
+    };
+    Stats stats() const;
+
+    struct RecoveryStats {
+        size_t segments = 0;
+        size_t records = 0;
+        uint64_t validBytes = 0;
+        // Bytes after the first torn or corrupt record, including whole
+        // segments dropped after it.
+        uint64_t discardedBytes = 0;
+        // Segments after the one holding that record.
+        size_t droppedSegments = 0;
+    };
+
+    // Replays the segments left over from the previous run, oldest first,
+    // up to the first torn or corrupt record. That segment is truncated
+    // there and every later one is deleted, since their records would be
+    // applied without the lost ones before them. Segments without records
+    // are deleted too.
+    RecoveryStats recover(
+        std::function<void(std::string &&, std::vector<uint8_t> &&, bool)>
+            applyOperation
+    );
 
 private:
-    std::string filename_;
+    std::string directory_;
+    WalSyncMode mode_;
     int fd_out_;
+    // Active segment; older ones down to oldestSegment_ may still exist.
+    uint64_t segment_ = 1;
+    uint64_t oldestSegment_ = 1;
+    // Segments found at startup, to be replayed by recover().
+    std::vector<uint64_t> recoverable_;
+
     userver::engine::Mutex walMutex_;
-    std::unique_ptr<boost_file_sink> out_;
+    userver::engine::ConditionVariable batchWritten_;
+    // Records appended but not yet handed to a leader.
+    std::string pending_;
+    uint64_t lastSeq_ = 0;
+    uint64_t writtenSeq_ = 0;
+    bool leaderActive_ = false;
+    bool failed_ = false;
+    bool unsynced_ = false;
+
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> syncs_{0};
+
+    userver::utils::PeriodicTask syncTask_;
+
+    std::string segmentPath(uint64_t segment) const;
+    void openForAppend();
+    void syncDirectory();
+    // Throws if the log is poisoned; requires walMutex_.
+    void checkNotFailed() const;
+    bool writeBatch(const std::string &batch);
+    bool sync(int fd);
+    void syncIfDirty();
 };
 
 }  // namespace DB
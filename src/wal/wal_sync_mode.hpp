@@ -0,0 +1,22 @@
+#ifndef WAL_SYNC_MODE_HPP_
+#define WAL_SYNC_MODE_HPP_
+
+namespace DB {
+
+// How far a WAL write is carried before the writer is acknowledged.
+enum class WalSyncMode {
+    // Nothing is logged; data since the last flush is lost on restart.
+    kNone,
+    // Each batch is handed to the OS with write(); survives a process crash
+    // but not a power loss.
+    kOsBuffered,
+    // Each batch is written and fdatasync'ed before writers return.
+    kFsyncPerBatch,
+    // Batches are written immediately and fdatasync'ed by a timer, bounding
+    // loss on power failure to the sync interval.
+    kFsyncPeriodic,
+};
+
+}  // namespace DB
+
+#endif  // WAL_SYNC_MODE_HPP_
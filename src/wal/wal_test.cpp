@@ -0,0 +1,496 @@
+#include "wal.hpp"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <userver/engine/async.hpp>
+#include <userver/engine/sleep.hpp>
+#include <userver/engine/task/current_task.hpp>
+#include <userver/fs/blocking/temp_directory.hpp>
+#include <userver/utest/utest.hpp>
+
+namespace DB {
+
+namespace {
+
+struct Record {
+    std::string key;
+    std::string value;
+    bool tombstone;
+
+    bool operator==(const Record &other) const {
+        return key == other.key && value == other.value &&
+               tombstone == other.tombstone;
+    }
+};
+
+// Framing of an insert: [crc:4][length:4][op:1][keySize:4][key]
+// [valueSize:4][value].
+size_t insertSize(const std::string &key, const std::string &value) {
+    return 8 + 1 + 4 + key.size() + 4 + value.size();
+}
+
+std::vector<uint8_t> blob(const std::string &value) {
+    return std::vector<uint8_t>(value.begin(), value.end());
+}
+
+void writeRecords(const std::string &dir, const std::vector<Record> &records) {
+    WAL wal(dir);
+    for (const auto &r : records) {
+        uint64_t seq = r.tombstone ? wal.appendRemove(r.key)
+                                   : wal.appendInsert(r.key, blob(r.value));
+        wal.commit(seq);
+    }
+}
+
+std::pair<std::vector<Record>, WAL::RecoveryStats> recoverRecords(
+    const std::string &dir
+) {
+    std::vector<Record> records;
+    WAL wal(dir);
+    auto stats = wal.recover([&records](
+                                 std::string &&key,
+                                 std::vector<uint8_t> &&value,
+                                 bool tombstone
+                             ) {
+        records.push_back(
+            {std::move(key), std::string(value.begin(), value.end()),
+             tombstone}
+        );
+    });
+    return {std::move(records), stats};
+}
+
+void corruptByte(const std::string &path, uint64_t offset, char mask = 0x40) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(offset);
+    char c = 0;
+    file.get(c);
+    file.seekp(offset);
+    file.put(static_cast<char>(c ^ mask));
+}
+
+// Commits each of `seqs` from its own task; returns how many commits threw.
+size_t commitConcurrently(WAL &wal, const std::vector<uint64_t> &seqs) {
+    std::atomic<size_t> failures{0};
+    std::vector<userver::engine::TaskWithResult<void>> tasks;
+    for (uint64_t seq : seqs) {
+        tasks.push_back(userver::engine::AsyncNoSpan(
+            userver::engine::current_task::GetTaskProcessor(),
+            [&wal, &failures, seq] {
+                try {
+                    wal.commit(seq);
+                } catch (const std::runtime_error &) {
+                    ++failures;
+                }
+            }
+        ));
+    }
+    for (auto &task : tasks) {
+        std::move(task).Get();
+    }
+    return failures.load();
+}
+
+// The active segment of a WAL opened in `dir` is /dev/full, so every write
+// to it fails.
+void makeSegmentUnwritable(const std::string &dir) {
+    std::filesystem::create_symlink("/dev/full", dir + "/wal_1.log");
+}
+
+const std::vector<Record> kRecords = {
+    {"alpha", "1", false},
+    {"beta", "22", false},
+    {"alpha", "", true},
+    {"gamma", "333", false},
+};
+
+}  // namespace
+
+UTEST(WAL, RecoversCommittedRecordsInOrder) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), kRecords);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(records, kRecords);
+    EXPECT_EQ(stats.segments, 1u);
+    EXPECT_EQ(stats.records, kRecords.size());
+    EXPECT_EQ(stats.discardedBytes, 0u);
+    EXPECT_EQ(
+        stats.validBytes,
+        std::filesystem::file_size(dir.GetPath() + "/wal_1.log")
+    );
+}
+
+UTEST(WAL, TruncatesTornTail) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), kRecords);
+    auto path = dir.GetPath() + "/wal_1.log";
+    auto size = std::filesystem::file_size(path);
+    // Cut the last record short, as a crash in the middle of a write would.
+    std::filesystem::resize_file(path, size - 2);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    std::vector<Record> expected(kRecords.begin(), kRecords.end() - 1);
+    EXPECT_EQ(records, expected);
+    uint64_t lastSize = insertSize("gamma", "333");
+    EXPECT_EQ(stats.discardedBytes, lastSize - 2);
+    EXPECT_EQ(stats.validBytes, size - lastSize);
+    EXPECT_EQ(std::filesystem::file_size(path), size - lastSize);
+}
+
+UTEST(WAL, TruncatesTornHeader) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), kRecords);
+    auto path = dir.GetPath() + "/wal_1.log";
+    auto size = std::filesystem::file_size(path);
+    uint64_t lastSize = insertSize("gamma", "333");
+    // Only part of the last record's header made it to disk.
+    std::filesystem::resize_file(path, size - lastSize + 5);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(records.size(), kRecords.size() - 1);
+    EXPECT_EQ(stats.discardedBytes, 5u);
+    EXPECT_EQ(std::filesystem::file_size(path), size - lastSize);
+}
+
+UTEST(WAL, StopsAtCorruptRecord) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), kRecords);
+    auto path = dir.GetPath() + "/wal_1.log";
+    auto size = std::filesystem::file_size(path);
+    uint64_t firstSize = insertSize("alpha", "1");
+    // Flip a bit in the second record's key: its CRC no longer matches, and
+    // nothing after it is trusted either.
+    corruptByte(path, firstSize + 8 + 1 + 4);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0], kRecords[0]);
+    EXPECT_EQ(stats.validBytes, firstSize);
+    EXPECT_EQ(stats.discardedBytes, size - firstSize);
+    EXPECT_EQ(std::filesystem::file_size(path), firstSize);
+}
+
+UTEST(WAL, RejectsCorruptLength) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), kRecords);
+    auto path = dir.GetPath() + "/wal_1.log";
+    uint64_t firstSize = insertSize("alpha", "1");
+    // A shorter length still fits in the file; the CRC covers the length
+    // field, so it is caught anyway.
+    corruptByte(path, firstSize + 4, 0x01);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(records.size(), 1u);
+    EXPECT_EQ(stats.validBytes, firstSize);
+}
+
+UTEST(WAL, DiscardsZeroFilledTail) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), kRecords);
+    auto path = dir.GetPath() + "/wal_1.log";
+    auto size = std::filesystem::file_size(path);
+    // Preallocated but never written blocks read back as zeros.
+    std::filesystem::resize_file(path, size + 4096);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(records, kRecords);
+    EXPECT_EQ(stats.discardedBytes, 4096u);
+    EXPECT_EQ(std::filesystem::file_size(path), size);
+}
+
+UTEST(WAL, TruncatedTailIsNotDiscardedTwice) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), kRecords);
+    auto path = dir.GetPath() + "/wal_1.log";
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    recoverRecords(dir.GetPath());
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(records.size(), kRecords.size() - 1);
+    EXPECT_EQ(stats.discardedBytes, 0u);
+}
+
+UTEST(WAL, ReplaysSegmentsOldestFirst) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        WAL wal(dir.GetPath());
+        wal.commit(wal.appendInsert("key", blob("old")));
+        EXPECT_EQ(wal.rotate(), 1u);
+        wal.commit(wal.appendInsert("key", blob("new")));
+        wal.commit(wal.appendRemove("other"));
+    }
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    std::vector<Record> expected = {
+        {"key", "old", false}, {"key", "new", false}, {"other", "", true}};
+    EXPECT_EQ(records, expected);
+    EXPECT_EQ(stats.segments, 2u);
+}
+
+UTEST(WAL, RemovesEmptySegments) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(dir.GetPath(), {});
+    ASSERT_TRUE(std::filesystem::exists(dir.GetPath() + "/wal_1.log"));
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_TRUE(records.empty());
+    EXPECT_FALSE(std::filesystem::exists(dir.GetPath() + "/wal_1.log"));
+}
+
+UTEST(WAL, RemovesSegmentsUpToFlushedOne) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    WAL wal(dir.GetPath());
+    wal.commit(wal.appendInsert("a", blob("1")));
+    auto first = wal.rotate();
+    wal.commit(wal.appendInsert("b", blob("2")));
+    auto second = wal.rotate();
+    wal.removeSegmentsUpTo(first);
+    EXPECT_FALSE(std::filesystem::exists(
+        dir.GetPath() + "/wal_" + std::to_string(first) + ".log"
+    ));
+    EXPECT_TRUE(std::filesystem::exists(
+        dir.GetPath() + "/wal_" + std::to_string(second) + ".log"
+    ));
+    EXPECT_THROW(wal.removeSegmentsUpTo(second + 1), std::logic_error);
+}
+
+UTEST(WAL, ConcurrentCommitsShareOneBatch) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        WAL wal(dir.GetPath(), WalSyncMode::kFsyncPerBatch);
+        std::vector<uint64_t> seqs;
+        for (const auto &r : kRecords) {
+            seqs.push_back(
+                r.tombstone ? wal.appendRemove(r.key)
+                            : wal.appendInsert(r.key, blob(r.value))
+            );
+        }
+        // Whichever committer leads writes everything appended so far; the
+        // others find their records already durable.
+        EXPECT_EQ(commitConcurrently(wal, seqs), 0u);
+        EXPECT_EQ(wal.stats().batches, 1u);
+        EXPECT_EQ(wal.stats().syncs, 1u);
+    }
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(records, kRecords);
+}
+
+UTEST_MT(WAL, GroupCommitKeepsEveryRecordOnce, 4) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    constexpr int kWriters = 4;
+    constexpr int kPerWriter = 50;
+    {
+        WAL wal(dir.GetPath(), WalSyncMode::kFsyncPerBatch);
+        std::vector<userver::engine::TaskWithResult<void>> writers;
+        for (int w = 0; w < kWriters; ++w) {
+            writers.push_back(userver::engine::AsyncNoSpan(
+                userver::engine::current_task::GetTaskProcessor(),
+                [&wal, w] {
+                    for (int i = 0; i < kPerWriter; ++i) {
+                        auto key = std::to_string(w) + "/" + std::to_string(i);
+                        wal.commit(wal.appendInsert(key, blob("v")));
+                    }
+                }
+            ));
+        }
+        for (auto &writer : writers) {
+            std::move(writer).Get();
+        }
+        EXPECT_EQ(wal.stats().syncs, wal.stats().batches);
+    }
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    ASSERT_EQ(records.size(), static_cast<size_t>(kWriters * kPerWriter));
+    // Each writer's records keep their order, whatever the interleaving.
+    std::vector<int> next(kWriters, 0);
+    for (const auto &r : records) {
+        int w = r.key[0] - '0';
+        EXPECT_EQ(r.key, std::to_string(w) + "/" + std::to_string(next[w]));
+        ++next[w];
+    }
+}
+
+UTEST(WAL, NoneModeLogsNothing) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        WAL wal(dir.GetPath(), WalSyncMode::kNone);
+        wal.commit(wal.appendInsert("alpha", blob("1")));
+        wal.commit(wal.appendRemove("alpha"));
+        EXPECT_EQ(std::filesystem::file_size(dir.GetPath() + "/wal_1.log"), 0u);
+        EXPECT_EQ(wal.stats().batches, 0u);
+        EXPECT_EQ(wal.stats().syncs, 0u);
+    }
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_TRUE(records.empty());
+}
+
+UTEST(WAL, OsBufferedModeWritesWithoutSync) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    WAL wal(dir.GetPath(), WalSyncMode::kOsBuffered);
+    wal.commit(wal.appendInsert("alpha", blob("1")));
+    EXPECT_EQ(
+        std::filesystem::file_size(dir.GetPath() + "/wal_1.log"),
+        insertSize("alpha", "1")
+    );
+    wal.commit(wal.appendInsert("beta", blob("2")));
+    wal.rotate();
+    EXPECT_EQ(wal.stats().batches, 2u);
+    EXPECT_EQ(wal.stats().syncs, 0u);
+}
+
+UTEST(WAL, FsyncPerBatchModeSyncsEveryBatch) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    WAL wal(dir.GetPath(), WalSyncMode::kFsyncPerBatch);
+    for (int i = 0; i < 3; ++i) {
+        wal.commit(wal.appendInsert("alpha", blob(std::to_string(i))));
+    }
+    EXPECT_EQ(wal.stats().batches, 3u);
+    EXPECT_EQ(wal.stats().syncs, 3u);
+    // Nothing is left unsynced for a rotation to cover.
+    wal.rotate();
+    EXPECT_EQ(wal.stats().syncs, 3u);
+}
+
+UTEST(WAL, FsyncPeriodicModeSyncsOnTimerAndRotation) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        // The timer never fires during the test.
+        WAL wal(dir.GetPath(), WalSyncMode::kFsyncPeriodic,
+                std::chrono::minutes(10));
+        wal.commit(wal.appendInsert("alpha", blob("1")));
+        wal.commit(wal.appendInsert("beta", blob("2")));
+        EXPECT_EQ(
+            std::filesystem::file_size(dir.GetPath() + "/wal_1.log"),
+            insertSize("alpha", "1") + insertSize("beta", "2")
+        );
+        EXPECT_EQ(wal.stats().batches, 2u);
+        EXPECT_EQ(wal.stats().syncs, 0u);
+        // A closed segment must not keep unsynced records.
+        wal.rotate();
+        EXPECT_EQ(wal.stats().syncs, 1u);
+    }
+    auto fastDir = userver::fs::blocking::TempDirectory::Create();
+    WAL wal(fastDir.GetPath(), WalSyncMode::kFsyncPeriodic,
+            std::chrono::milliseconds(5));
+    wal.commit(wal.appendInsert("alpha", blob("1")));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (wal.stats().syncs == 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+        userver::engine::SleepFor(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(wal.stats().syncs, 1u);
+}
+
+UTEST(WAL, FailedWritePoisonsTheLog) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    makeSegmentUnwritable(dir.GetPath());
+    WAL wal(dir.GetPath(), WalSyncMode::kFsyncPerBatch);
+    auto seq = wal.appendInsert("alpha", blob("1"));
+    EXPECT_THROW(wal.commit(seq), std::runtime_error);
+    // The tail of the log is unknown from here on, so nothing more is taken
+    // or acknowledged, not even after moving to a fresh segment.
+    EXPECT_THROW(wal.commit(seq), std::runtime_error);
+    EXPECT_THROW(wal.appendInsert("beta", blob("2")), std::runtime_error);
+    EXPECT_THROW(wal.appendRemove("alpha"), std::runtime_error);
+    wal.rotate();
+    EXPECT_THROW(wal.appendInsert("beta", blob("2")), std::runtime_error);
+}
+
+UTEST(WAL, FailedBatchFailsEveryCommitter) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    makeSegmentUnwritable(dir.GetPath());
+    WAL wal(dir.GetPath(), WalSyncMode::kOsBuffered);
+    std::vector<uint64_t> seqs;
+    for (int i = 0; i < 4; ++i) {
+        seqs.push_back(wal.appendInsert("key" + std::to_string(i), blob("v")));
+    }
+    EXPECT_EQ(commitConcurrently(wal, seqs), seqs.size());
+    EXPECT_EQ(wal.stats().batches, 1u);
+}
+
+UTEST(WAL, IgnoresMalformedSegmentNames) {
+    auto source = userver::fs::blocking::TempDirectory::Create();
+    writeRecords(source.GetPath(), kRecords);
+    auto segment = source.GetPath() + "/wal_1.log";
+
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    std::filesystem::copy_file(segment, dir.GetPath() + "/wal_2.log");
+    const std::vector<std::string> malformed = {
+        "wal_+3.log", "wal_ 3.log", "wal_3x.log", "wal_-3.log",
+        "wal_99999999999999999999999.log"};
+    for (const auto &name : malformed) {
+        std::filesystem::copy_file(segment, dir.GetPath() + "/" + name);
+    }
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(records, kRecords);
+    EXPECT_EQ(stats.segments, 1u);
+    for (const auto &name : malformed) {
+        EXPECT_TRUE(std::filesystem::exists(dir.GetPath() + "/" + name))
+            << name;
+    }
+    // New records go after the highest well-formed segment.
+    EXPECT_TRUE(std::filesystem::exists(dir.GetPath() + "/wal_3.log"));
+}
+
+UTEST(WAL, CorruptRecordEndsReplayOfLaterSegments) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        WAL wal(dir.GetPath());
+        wal.commit(wal.appendInsert("a", blob("1")));
+        wal.rotate();
+        wal.commit(wal.appendInsert("b", blob("2")));
+        wal.commit(wal.appendInsert("a", blob("3")));
+        wal.rotate();
+        wal.commit(wal.appendRemove("b"));
+    }
+    auto second = dir.GetPath() + "/wal_2.log";
+    auto third = dir.GetPath() + "/wal_3.log";
+    auto thirdSize = std::filesystem::file_size(third);
+    uint64_t validSize = insertSize("b", "2");
+    // The overwrite of "a" is lost; the later removal of "b" must not be
+    // applied without it.
+    corruptByte(second, validSize + 8 + 1 + 4);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    std::vector<Record> expected = {{"a", "1", false}, {"b", "2", false}};
+    EXPECT_EQ(records, expected);
+    EXPECT_EQ(stats.segments, 2u);
+    EXPECT_EQ(stats.droppedSegments, 1u);
+    EXPECT_EQ(stats.discardedBytes, insertSize("a", "3") + thirdSize);
+    EXPECT_EQ(std::filesystem::file_size(second), validSize);
+    EXPECT_FALSE(std::filesystem::exists(third));
+
+    // What is left replays the same way again.
+    auto [again, againStats] = recoverRecords(dir.GetPath());
+    EXPECT_EQ(again, expected);
+    EXPECT_EQ(againStats.discardedBytes, 0u);
+    EXPECT_EQ(againStats.droppedSegments, 0u);
+}
+
+UTEST(WAL, CorruptFirstRecordDropsItsSegment) {
+    auto dir = userver::fs::blocking::TempDirectory::Create();
+    {
+        WAL wal(dir.GetPath());
+        wal.commit(wal.appendInsert("a", blob("1")));
+        wal.rotate();
+        wal.commit(wal.appendInsert("b", blob("2")));
+        wal.rotate();
+        wal.commit(wal.appendInsert("c", blob("3")));
+    }
+    corruptByte(dir.GetPath() + "/wal_2.log", 0);
+
+    auto [records, stats] = recoverRecords(dir.GetPath());
+    std::vector<Record> expected = {{"a", "1", false}};
+    EXPECT_EQ(records, expected);
+    EXPECT_EQ(stats.droppedSegments, 1u);
+    EXPECT_TRUE(std::filesystem::exists(dir.GetPath() + "/wal_1.log"));
+    EXPECT_FALSE(std::filesystem::exists(dir.GetPath() + "/wal_2.log"));
+    EXPECT_FALSE(std::filesystem::exists(dir.GetPath() + "/wal_3.log"));
+}
+
+}  // namespace DB
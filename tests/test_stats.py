@@ -0,0 +1,23 @@
+async def test_stats_report_block_cache(service_client):
+
+    response = await service_client.put('/database/stats:key', json={'value': 'v'})
+    assert response.status_code == 200, f"PUT failed: {response.text}"
+    response = await service_client.get('/database/stats:key')
+    assert response.status_code == 200, f"GET failed: {response.text}"
+
+    response = await service_client.get('/stats')
+    assert response.status_code == 200, f"Stats failed: {response.text}"
+    cache = response.json()['block_cache']
+    for field in ('hits', 'misses', 'evictions', 'usage_bytes', 'pinned_bytes', 'capacity_bytes'):
+        assert isinstance(cache[field], int) and cache[field] >= 0, field
+    assert cache['capacity_bytes'] > 0
+    assert cache['pinned_bytes'] <= cache['usage_bytes']
+
+
+async def test_stats_report_background_io(service_client):
+
+    response = await service_client.get('/stats')
+    assert response.status_code == 200, f"Stats failed: {response.text}"
+    io = response.json()['background_io']
+    for field in ('bytes_per_second', 'bytes', 'throttled_requests', 'throttled_time_us', 'foreground_latency_us'):
+        assert isinstance(io[field], int) and io[field] >= 0, field